@@ -0,0 +1,26 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace silk::bench
+{
+    // nanoseconds per operation for `ops` operations performed by fn
+    template <typename Fn>
+    double measureNsPerOp(size_t ops, Fn&& fn)
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+        fn();
+        const auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(ops);
+    }
+
+    // folds results into a value that is printed so the optimizer cannot discard the measured work
+    inline uint64_t checksum = 0;
+
+    inline void report(const char* name, size_t count, double nsPerOp)
+    {
+        std::printf("%-48s %10zu %10.2f ns/op\n", name, count, nsPerOp);
+    }
+}
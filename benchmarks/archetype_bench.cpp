@@ -0,0 +1,91 @@
+#include "silk/ECS.h"
+#include "Bench.h"
+
+#include <random>
+
+using namespace silk;
+
+struct Position { float x, y; };
+struct Velocity { float dx, dy; };
+struct Matrix { float m[16]; };
+struct Health { int hp; };
+
+// components are added in a different shuffled order per type, so the sparse pools' dense arrays do not line up
+void populate(Scene& scene, size_t count)
+{
+    std::vector<Entity> entities(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        entities[i] = scene.createEntity();
+    }
+
+    std::mt19937 rng(42);
+    std::shuffle(entities.begin(), entities.end(), rng);
+    for (Entity e : entities)
+    {
+        scene.addComponent(e, Position{ 0.0f, 0.0f });
+    }
+
+    std::shuffle(entities.begin(), entities.end(), rng);
+    for (Entity e : entities)
+    {
+        scene.addComponent(e, Velocity{ 1.0f, 1.0f });
+    }
+
+    std::shuffle(entities.begin(), entities.end(), rng);
+    for (size_t i = 0; i < count; i++)
+    {
+        scene.addComponent(entities[i], Matrix{});
+
+        // a second archetype so iteration has to skip / join over more than one signature
+        if (i % 4 == 0)
+        {
+            scene.addComponent(entities[i], Health{ 100 });
+        }
+    }
+}
+
+void run(const char* name, StorageMode storageMode, size_t count)
+{
+    char label[64];
+    Scene scene(storageMode);
+
+    std::snprintf(label, sizeof(label), "%s populate", name);
+    bench::report(label, count, bench::measureNsPerOp(count, [&] { populate(scene, count); }));
+
+    std::snprintf(label, sizeof(label), "%s each<Position, Velocity>", name);
+    bench::report(label, count, bench::measureNsPerOp(count, [&]
+    {
+        scene.each<Position, const Velocity>([](Position& pos, const Velocity& vel)
+        {
+            pos.x += vel.dx;
+            pos.y += vel.dy;
+        });
+    }));
+
+    std::snprintf(label, sizeof(label), "%s each<Position, Velocity, Matrix>", name);
+    bench::report(label, count, bench::measureNsPerOp(count, [&]
+    {
+        scene.each<Position, const Velocity, Matrix>([](Position& pos, const Velocity& vel, Matrix& mat)
+        {
+            pos.x += vel.dx;
+            pos.y += vel.dy;
+            mat.m[12] = pos.x;
+            mat.m[13] = pos.y;
+        });
+    }));
+
+    scene.each<const Matrix>([](const Matrix& mat) { bench::checksum += static_cast<uint64_t>(mat.m[12]); });
+}
+
+int main()
+{
+    for (size_t count : { 10'000, 100'000, 1'000'000 })
+    {
+        run("sparse", StorageMode::Sparse, count);
+        run("archetype", StorageMode::Archetype, count);
+    }
+
+    std::printf("checksum %llu\n", static_cast<unsigned long long>(bench::checksum));
+    return 0;
+}
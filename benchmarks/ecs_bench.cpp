@@ -0,0 +1,199 @@
+#include "silk/ECS.h"
+#include "Bench.h"
+
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace silk;
+
+struct Position { float x, y; };
+struct Velocity { float dx, dy; };
+struct Health { int hp; };
+
+struct Result
+{
+    const char* name;
+    const char* storage;
+    size_t count;
+    double nsPerOp;
+};
+
+static std::vector<Result> results;
+
+// every run below repeats until about this many operations were timed, so small entity counts are not just timer noise
+static constexpr size_t MIN_TIMED_OPS = 2'000'000;
+
+// times only fn(scene, entities), setup builds a fresh scene for each repetition
+template <typename Setup, typename Fn>
+void measure(const char* name, StorageMode storageMode, size_t count, Setup&& setup, Fn&& fn)
+{
+    const size_t repetitions = std::max<size_t>(1, MIN_TIMED_OPS / count);
+    double totalNs = 0.0;
+    for (size_t i = 0; i < repetitions; i++)
+    {
+        Scene scene(storageMode);
+        std::vector<Entity> entities = setup(scene);
+        const auto start = std::chrono::steady_clock::now();
+        fn(scene, entities);
+        const auto end = std::chrono::steady_clock::now();
+        totalNs += std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    const char* storage = storageMode == StorageMode::Sparse ? "sparse" : "archetype";
+    results.push_back({ name, storage, count, totalNs / static_cast<double>(repetitions * count) });
+}
+
+std::vector<Entity> shuffled(std::vector<Entity> entities)
+{
+    std::mt19937 rng(42);
+    std::shuffle(entities.begin(), entities.end(), rng);
+    return entities;
+}
+
+void run(StorageMode storageMode, size_t count)
+{
+    auto empty = [](Scene&) { return std::vector<Entity>(); };
+    auto createEmpty = [count](Scene& scene)
+    {
+        std::vector<Entity> entities(count);
+        for (Entity& e : entities)
+        {
+            e = scene.createEntity();
+        }
+        return shuffled(std::move(entities));
+    };
+    // every entity has Position and Velocity, every other one Health
+    auto populate = [count](Scene& scene)
+    {
+        std::vector<Entity> entities(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            entities[i] = i % 2 == 0 ? scene.createEntity(Position{ 0.0f, 0.0f }, Velocity{ 1.0f, 1.0f }, Health{ 100 })
+                                     : scene.createEntity(Position{ 0.0f, 0.0f }, Velocity{ 1.0f, 1.0f });
+        }
+        return shuffled(std::move(entities));
+    };
+
+    measure("create", storageMode, count, empty, [count](Scene& scene, std::vector<Entity>&)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            scene.createEntity();
+        }
+    });
+
+    measure("add", storageMode, count, createEmpty, [](Scene& scene, std::vector<Entity>& entities)
+    {
+        for (Entity e : entities)
+        {
+            scene.addComponent(e, Position{ 1.0f, 2.0f });
+        }
+    });
+
+    measure("get", storageMode, count, populate, [](Scene& scene, std::vector<Entity>& entities)
+    {
+        float sum = 0.0f;
+        for (Entity e : entities)
+        {
+            sum += scene.getComponent<const Position>(e).x;
+        }
+        bench::checksum += static_cast<uint64_t>(sum);
+    });
+
+    measure("remove", storageMode, count, populate, [](Scene& scene, std::vector<Entity>& entities)
+    {
+        for (Entity e : entities)
+        {
+            scene.removeComponent<Velocity>(e);
+        }
+    });
+
+    measure("delete", storageMode, count, populate, [](Scene& scene, std::vector<Entity>& entities)
+    {
+        for (Entity e : entities)
+        {
+            scene.deleteEntity(e);
+        }
+    });
+
+    measure("query<Position>", storageMode, count, populate, [](Scene& scene, std::vector<Entity>&)
+    {
+        scene.each<Position>([](Position& pos) { pos.x += 1.0f; });
+    });
+
+    measure("query<Position, Velocity>", storageMode, count, populate, [](Scene& scene, std::vector<Entity>&)
+    {
+        scene.each<Position, const Velocity>([](Position& pos, const Velocity& vel)
+        {
+            pos.x += vel.dx;
+            pos.y += vel.dy;
+        });
+    });
+
+    measure("query<Position, Velocity, Health>", storageMode, count, populate, [](Scene& scene, std::vector<Entity>&)
+    {
+        scene.each<Position, const Velocity, const Health>([](Position& pos, const Velocity& vel, const Health& health)
+        {
+            pos.x += vel.dx * static_cast<float>(health.hp);
+        });
+    });
+
+    // one op deletes a random entity, spawns a replacement and toggles Health on another, as gameplay code does
+    measure("churn", storageMode, count, populate, [count](Scene& scene, std::vector<Entity>& entities)
+    {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<size_t> pick(0, count - 1);
+        for (size_t i = 0; i < count; i++)
+        {
+            Entity& victim = entities[pick(rng)];
+            scene.deleteEntity(victim);
+            victim = scene.createEntity(Position{ 0.0f, 0.0f }, Velocity{ 1.0f, 1.0f });
+
+            const Entity other = entities[pick(rng)];
+            if (scene.hasComponent<Health>(other))
+            {
+                scene.removeComponent<Health>(other);
+            }
+            else
+            {
+                scene.addComponent(other, Health{ 100 });
+            }
+        }
+    });
+
+    for (const Result& result : results)
+    {
+        if (result.count == count && std::strcmp(result.storage, storageMode == StorageMode::Sparse ? "sparse" : "archetype") == 0)
+        {
+            char label[64];
+            std::snprintf(label, sizeof(label), "%s %s", result.storage, result.name);
+            std::fprintf(stderr, "%-48s %10zu %10.2f ns/op\n", label, result.count, result.nsPerOp);
+        }
+    }
+}
+
+// usage: silk_bench_ecs [max entity count], the JSON report goes to stdout and a readable table to stderr
+int main(int argc, char** argv)
+{
+    const size_t maxCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+
+    for (size_t count = 1'000; count <= maxCount; count *= 10)
+    {
+        run(StorageMode::Sparse, count);
+        run(StorageMode::Archetype, count);
+    }
+
+    std::printf("{\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& result = results[i];
+        std::printf("    { \"name\": \"%s\", \"storage\": \"%s\", \"entities\": %zu, \"ns_per_op\": %.3f, \"ops_per_second\": %.0f }%s\n",
+                    result.name, result.storage, result.count, result.nsPerOp, 1e9 / result.nsPerOp, i + 1 < results.size() ? "," : "");
+    }
+    std::printf("  ],\n  \"checksum\": %llu\n}\n", static_cast<unsigned long long>(bench::checksum));
+    return 0;
+}
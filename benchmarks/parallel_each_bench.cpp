@@ -0,0 +1,68 @@
+#include "silk/ECS.h"
+#include "Bench.h"
+
+using namespace silk;
+
+struct Position { float x, y; };
+struct Velocity { float dx, dy; };
+
+int main()
+{
+    const size_t COUNT = 1'000'000;
+    const size_t GRAIN_SIZE = 16 * 1024;
+    const int ITERATIONS = 20;
+    const float DT = 1.0f / 60.0f;
+    const uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    // 1, 2, 4, ... up to and including every hardware thread
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (StorageMode storageMode : { StorageMode::Sparse, StorageMode::Archetype })
+    {
+        Scene scene(storageMode);
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            scene.createEntity(Position{ 0.0f, 0.0f }, Velocity{ 1.0f, static_cast<float>(i % 7) });
+        }
+
+        double singleThreadedNs = 0.0;
+        for (uint32_t threads : threadCounts)
+        {
+            // the calling thread takes part in parallelEach, so it counts as one of the threads
+            ThreadPool threadPool(threads - 1);
+            scene.setThreadPool(&threadPool);
+
+            const double ns = bench::measureNsPerOp(COUNT * ITERATIONS, [&]
+            {
+                for (int i = 0; i < ITERATIONS; i++)
+                {
+                    scene.parallelEach<Position, const Velocity>([DT](Position& pos, const Velocity& vel)
+                    {
+                        pos.x += vel.dx * DT;
+                        pos.y += vel.dy * DT;
+                    }, GRAIN_SIZE);
+                }
+            });
+
+            if (threads == 1)
+            {
+                singleThreadedNs = ns;
+            }
+
+            char label[64];
+            std::snprintf(label, sizeof(label), "%s parallelEach %u threads (%.2fx)", storageMode == StorageMode::Sparse ? "sparse" : "archetype", threads, singleThreadedNs / ns);
+            bench::report(label, COUNT, ns);
+        }
+
+        scene.setThreadPool(nullptr);
+        scene.each<const Position>([](const Position& pos) { bench::checksum += static_cast<uint64_t>(pos.y); });
+    }
+
+    std::printf("checksum %llu\n", static_cast<unsigned long long>(bench::checksum));
+    return 0;
+}
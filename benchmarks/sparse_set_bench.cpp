@@ -0,0 +1,122 @@
+#include "silk/ECS.h"
+#include "Bench.h"
+
+#include <unordered_map>
+#include <random>
+
+using namespace silk;
+
+// the unordered_map backed pool ComponentPool used before the paged sparse index
+template <typename T>
+struct MapComponentPool
+{
+    std::vector<T> components;
+    std::vector<Entity> owners;
+    std::unordered_map<Entity, uint32_t> entityToComponentIndex;
+
+    void add(Entity e, T component)
+    {
+        entityToComponentIndex[e] = static_cast<uint32_t>(components.size());
+        owners.push_back(e);
+        components.push_back(component);
+    }
+
+    void remove(Entity e)
+    {
+        uint32_t deletedIdx = entityToComponentIndex[e];
+        uint32_t lastIdx = static_cast<uint32_t>(components.size() - 1);
+        components[deletedIdx] = components[lastIdx];
+        Entity movedEntity = owners[lastIdx];
+        owners[deletedIdx] = movedEntity;
+        entityToComponentIndex[movedEntity] = deletedIdx;
+        components.pop_back();
+        owners.pop_back();
+        entityToComponentIndex.erase(e);
+    }
+
+    bool has(Entity e) const { return entityToComponentIndex.count(e) > 0; }
+
+    T& get(Entity e) { return components[entityToComponentIndex[e]]; }
+};
+
+template <typename T>
+struct SparseComponentPool
+{
+    ComponentPool<T> pool;
+
+    void add(Entity e, T component)
+    {
+        pool.emplace(e, component);
+    }
+
+    void remove(Entity e) { pool.remove(e); }
+
+    bool has(Entity e) const { return pool.has(e); }
+
+    T& get(Entity e) { return pool.components[pool.entityToComponentIndex.get(e)]; }
+};
+
+struct Position { float x, y; };
+
+template <typename Pool>
+void run(const char* name, const std::vector<Entity>& shuffled)
+{
+    const size_t count = shuffled.size();
+    Pool pool;
+    char label[64];
+
+    std::snprintf(label, sizeof(label), "%s add", name);
+    bench::report(label, count, bench::measureNsPerOp(count, [&]
+    {
+        for (Entity e = 0; e < count; e++)
+        {
+            pool.add(e, Position{ static_cast<float>(e), 0.0f });
+        }
+    }));
+
+    std::snprintf(label, sizeof(label), "%s has (random)", name);
+    bench::report(label, count, bench::measureNsPerOp(count, [&]
+    {
+        for (Entity e : shuffled)
+        {
+            bench::checksum += pool.has(e);
+        }
+    }));
+
+    std::snprintf(label, sizeof(label), "%s get (random)", name);
+    bench::report(label, count, bench::measureNsPerOp(count, [&]
+    {
+        for (Entity e : shuffled)
+        {
+            bench::checksum += static_cast<uint64_t>(pool.get(e).x);
+        }
+    }));
+
+    std::snprintf(label, sizeof(label), "%s remove (random)", name);
+    bench::report(label, count, bench::measureNsPerOp(count, [&]
+    {
+        for (Entity e : shuffled)
+        {
+            pool.remove(e);
+        }
+    }));
+}
+
+int main()
+{
+    for (size_t count : { 10'000, 100'000, 1'000'000 })
+    {
+        std::vector<Entity> shuffled(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            shuffled[i] = static_cast<Entity>(i);
+        }
+        std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(42));
+
+        run<MapComponentPool<Position>>("unordered_map", shuffled);
+        run<SparseComponentPool<Position>>("sparse index", shuffled);
+    }
+
+    std::printf("checksum %llu\n", static_cast<unsigned long long>(bench::checksum));
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "silk/SpatialGrid.h"
+#include "Bench.h"
+
+#include <random>
+
+using namespace silk;
+
+// 1M points random-walking in a 4096 x 4096 world, every point moves every frame
+int main()
+{
+    constexpr size_t COUNT = 1'000'000;
+    constexpr int FRAMES = 5;
+    constexpr int QUERIES = 10'000;
+    constexpr float WORLD_SIZE = 4096.0f;
+
+    Scene scene;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> coordinate(0.0f, WORLD_SIZE);
+    std::uniform_real_distribution<float> step(-1.0f, 1.0f);
+    std::vector<Entity> entities;
+    entities.reserve(COUNT);
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        entities.push_back(scene.createEntity(Transform(glm::vec2(coordinate(rng), coordinate(rng)), 0.0f, glm::vec2(0.0f, 0.0f))));
+    }
+
+    std::unique_ptr<SpatialGrid> grid;
+    bench::report("SpatialGrid build", COUNT, bench::measureNsPerOp(COUNT, [&] { grid = std::make_unique<SpatialGrid>(scene, 8.0f); }));
+
+    double moveNs = 0.0;
+    double updateNs = 0.0;
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        moveNs += bench::measureNsPerOp(COUNT, [&]
+        {
+            scene.each<Transform>([&](Transform& transform)
+            {
+                transform.setPosition(transform.getPosition() + glm::vec2(step(rng), step(rng)));
+            });
+        });
+        updateNs += bench::measureNsPerOp(COUNT, [&] { grid->update(); });
+    }
+    bench::report("move Transforms (not part of the grid)", COUNT, moveNs / FRAMES);
+    bench::report("SpatialGrid update, all points moved", COUNT, updateNs / FRAMES);
+
+    std::vector<glm::vec2> points(QUERIES);
+    for (glm::vec2& point : points)
+    {
+        point = glm::vec2(coordinate(rng), coordinate(rng));
+    }
+
+    bench::report("SpatialGrid queryRadius r=16", COUNT, bench::measureNsPerOp(QUERIES, [&]
+    {
+        for (const glm::vec2& point : points)
+        {
+            grid->queryRadius(point, 16.0f, [](Entity e) { bench::checksum += e; });
+        }
+    }));
+
+    bench::report("SpatialGrid queryAABB 32x32", COUNT, bench::measureNsPerOp(QUERIES, [&]
+    {
+        for (const glm::vec2& point : points)
+        {
+            grid->queryAABB(point, point + glm::vec2(32.0f, 32.0f), [](Entity e) { bench::checksum += e; });
+        }
+    }));
+
+    bench::report("SpatialGrid queryNearest", COUNT, bench::measureNsPerOp(QUERIES, [&]
+    {
+        for (const glm::vec2& point : points)
+        {
+            bench::checksum += grid->queryNearest(point).value_or(0);
+        }
+    }));
+
+    // the full scan the grid replaces, only a few queries since each touches every Transform
+    constexpr int SCAN_QUERIES = 10;
+    bench::report("full scan queryRadius r=16", COUNT, bench::measureNsPerOp(SCAN_QUERIES, [&]
+    {
+        for (int i = 0; i < SCAN_QUERIES; i++)
+        {
+            const glm::vec2 point = points[i];
+            scene.each<const Transform>([&](Entity e, const Transform& transform)
+            {
+                const glm::vec2 d = transform.getPosition() - point;
+                if (d.x * d.x + d.y * d.y <= 16.0f * 16.0f)
+                {
+                    bench::checksum += e;
+                }
+            });
+        }
+    }));
+
+    std::printf("checksum %llu\n", static_cast<unsigned long long>(bench::checksum));
+    return 0;
+}
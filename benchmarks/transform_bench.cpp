@@ -0,0 +1,143 @@
+#include "silk/Transform.h"
+#include "silk/TransformBatch.h"
+#include "Bench.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <math.h>
+#include <random>
+#include <vector>
+
+using namespace silk;
+
+// Transform as it was before matrices were evaluated lazily, every setter rebuilds a glm::mat4
+class EagerTransform
+{
+public:
+    EagerTransform(glm::vec2 position, float rotation, glm::vec2 scale) : pos(position), rot(rotation), s(scale) { updateMat(); }
+    glm::mat4 getMatrix() const { return mat; }
+    void setPosition(float x, float y) { pos = glm::vec2(x, y); updateMat(); }
+    void setRotation(float rotation) { rot = rotation; updateMat(); }
+    void setScale(float x, float y) { s = glm::vec2(x, y); updateMat(); }
+private:
+    glm::vec2 pos;
+    float rot;
+    glm::vec2 s;
+    glm::mat4 mat;
+
+    void updateMat()
+    {
+        glm::mat4 rotMatrix(
+            cos(rot), sin(rot), 0.0f, 0.0f,
+            -sin(rot), cos(rot), 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        );
+        mat = glm::translate(glm::mat4(1.0f), glm::vec3(pos.x, pos.y, 0.0f)) * rotMatrix * glm::scale(glm::mat4(1.0f), glm::vec3(s.x, s.y, 1.0f));
+    }
+};
+
+template <typename T>
+void run(const char* name, size_t count)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+    std::vector<T> transforms;
+    transforms.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        transforms.emplace_back(glm::vec2(value(rng), value(rng)), value(rng), glm::vec2(1.0f, 1.0f));
+    }
+
+    char label[64];
+    std::snprintf(label, sizeof(label), "%s setPosition", name);
+    bench::report(label, count, bench::measureNsPerOp(count, [&]
+    {
+        for (T& transform : transforms)
+        {
+            transform.setPosition(1.0f, 2.0f);
+        }
+    }));
+
+    // what a moving, spinning, pulsing sprite does every frame
+    std::snprintf(label, sizeof(label), "%s set position + rotation + scale", name);
+    bench::report(label, count, bench::measureNsPerOp(count, [&]
+    {
+        float t = 0.0f;
+        for (T& transform : transforms)
+        {
+            transform.setPosition(t, t);
+            transform.setRotation(t);
+            transform.setScale(t, t);
+            t += 0.001f;
+        }
+    }));
+
+    // first read after the sets above, the lazy Transform evaluates here
+    std::snprintf(label, sizeof(label), "%s getMatrix after set", name);
+    bench::report(label, count, bench::measureNsPerOp(count, [&]
+    {
+        float sum = 0.0f;
+        for (const T& transform : transforms)
+        {
+            sum += transform.getMatrix()[3][0];
+        }
+        bench::checksum += static_cast<uint64_t>(sum);
+    }));
+
+    std::snprintf(label, sizeof(label), "%s getMatrix clean", name);
+    bench::report(label, count, bench::measureNsPerOp(count, [&]
+    {
+        float sum = 0.0f;
+        for (const T& transform : transforms)
+        {
+            sum += transform.getMatrix()[0][0];
+        }
+        bench::checksum += static_cast<uint64_t>(sum);
+    }));
+}
+
+// every matrix of a freshly changed pool, one at a time through getMatrix() and in batches through computeMatrices()
+void runBatch(size_t count)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+    std::vector<Transform> transforms;
+    transforms.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        transforms.emplace_back(glm::vec2(value(rng), value(rng)), value(rng), glm::vec2(1.0f, 1.0f));
+    }
+    std::vector<glm::mat4> matrices(count);
+
+    bench::report("getMatrix per Transform", count, bench::measureNsPerOp(count, [&]
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            transforms[i].setRotation(transforms[i].getRotation());
+            matrices[i] = transforms[i].getMatrix();
+        }
+    }));
+    bench::checksum += static_cast<uint64_t>(matrices[count / 2][3][0]);
+
+    const char* names[] = { "computeMatrices scalar", "computeMatrices SSE2", "computeMatrices AVX2" };
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 })
+    {
+        if (level > getSimdLevel())
+        {
+            continue;
+        }
+        bench::report(names[static_cast<int>(level)], count, bench::measureNsPerOp(count, [&] { computeMatrices(transforms, matrices, level); }));
+        bench::checksum += static_cast<uint64_t>(matrices[count / 2][3][0]);
+    }
+}
+
+int main()
+{
+    constexpr size_t COUNT = 1'000'000;
+    std::printf("sizeof(Transform) %zu, before %zu\n", sizeof(Transform), sizeof(EagerTransform));
+    run<EagerTransform>("before", COUNT);
+    run<Transform>("lazy", COUNT);
+    runBatch(COUNT);
+    std::printf("checksum %llu\n", static_cast<unsigned long long>(bench::checksum));
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "silk/Engine.h"
+#include "silk/FixedTimestep.h"
 
 #include <iostream>
 #include <fstream>
@@ -6,6 +7,8 @@
 #include <set>
 #include <optional>
 #include <algorithm>
+#include <cmath>
+#include <numbers>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <chrono>
@@ -23,8 +26,8 @@ glm::vec3 sphericalToCartesian(float radius, float theta, float phi)
     return glm::vec3(radius * sin(thetaRadians) * sin(phiRadians), radius * cos(phiRadians), radius * cos(thetaRadians) * sin(phiRadians));
 }
 
-const float SCROLL_SPEED = 10.0f;
-float camRadius = 500.0f;
+const float SCROLL_SPEED = 100.0f;
+float camRadius = 4000.0f;
 float theta = 0.0f, phi = 90.0f;
 glm::vec3 cameraPosition(0.0f, 0.0f, camRadius);
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
@@ -231,7 +234,7 @@ int main()
         static VkShaderStageFlags getStageFlags() { return VK_SHADER_STAGE_VERTEX_BIT; }
     };
 
-    using VertexInputPack = std::tuple<Vertex>;
+    using VertexInputPack = std::tuple<Vertex, silk::InstanceData>;
     using PushConstantPack = std::tuple<ModelPC>;
     auto pipelineContextCreateInfo = silk::PipelineContextCreateInfo::build<VertexInputPack, PushConstantPack>({ descriptorSetLayout });
 
@@ -248,6 +251,9 @@ int main()
         VK_CHECK(vkCreateCommandPool(deviceContext.getDevice(), &commandPoolCreateInfo, nullptr, &commandPool));
     }
 
+    // create UploadQueue, the buffers and textures below are copied in one batch
+    silk::UploadQueue uploadQueue(deviceContext);
+
     // load Rubber Ducky gltf model
     const std::string FILENAME = ".\\model\\Duck.gltf";
     const tinygltf::Model model = silk::loadGLTFModel(FILENAME);
@@ -265,11 +271,11 @@ int main()
         vertices[i].uv = uvs[i];
     }
 
-    silk::DeviceLocalBufferContext<Vertex> vertexBufferContext(deviceContext, commandPool, vertices, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    silk::DeviceLocalBufferContext<Vertex> vertexBufferContext(deviceContext, uploadQueue, vertices, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
 
     // create index buffer
     const std::vector<uint16_t> indices = silk::getGLTFModelIndices(model);
-    silk::DeviceLocalBufferContext<uint16_t> indexBufferContext(deviceContext, commandPool, indices, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    silk::DeviceLocalBufferContext<uint16_t> indexBufferContext(deviceContext, uploadQueue, indices, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
     // create texture image
     tinygltf::Image tinyImage;
@@ -280,28 +286,36 @@ int main()
         tinyImage = model.images[texture.source];
     }
 
-    silk::DeviceLocalImageContext albedoTexContext(deviceContext, commandPool, tinyImage);
+    silk::DeviceLocalImageContext albedoTexContext(deviceContext, uploadQueue, tinyImage);
+
+    // frames are submitted to the same queue after this, so they see the uploads without waiting on them
+    uploadQueue.flush();
     
-    // create (instance) VkBuffer
     const int MAX_FRAMES_IN_FLIGHT = 2;
-    // uint32_t maxInstances = 100;
-    // std::vector<uint32_t> instanceCounts;
-    // std::vector<VkBuffer> instanceBuffers;
-    // std::vector<VkDeviceMemory> instanceBuffersMemory;
-    // std::vector<void*> instanceBuffersMapped;
-    // {
-    //     instanceCounts.resize(MAX_FRAMES_IN_FLIGHT);
-    //     instanceBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    //     instanceBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-    //     instanceBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
-
-    //     VkDeviceSize instanceBufferSize = sizeof(silk::InstanceData) * maxInstances;
-    //     for (size_t i = 0; i < static_cast<size_t>(MAX_FRAMES_IN_FLIGHT); i++)
-    //     {
-    //         VK_CHECK(silk::createBuffer(physicalDevice, device, instanceBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instanceBuffers[i], instanceBuffersMemory[i]));
-    //         VK_CHECK(vkMapMemory(device, instanceBuffersMemory[i], 0, instanceBufferSize, 0, &instanceBuffersMapped[i]));
-    //     }
-    // }
+
+    // a grid of ducks, each spinning at its own rate
+    struct Spin
+    {
+        float speed;
+    };
+
+    silk::Scene scene;
+    {
+        const int GRID_SIZE = 32;
+        const float SPACING = 200.0f;
+        for (int y = 0; y < GRID_SIZE; y++)
+        {
+            for (int x = 0; x < GRID_SIZE; x++)
+            {
+                const glm::vec2 position((x - GRID_SIZE / 2) * SPACING, (y - GRID_SIZE / 2) * SPACING);
+                scene.createEntity(silk::Transform(position), Spin{ 0.5f + 0.25f * ((x + y) % 8) });
+            }
+        }
+    }
+    silk::TransformInterpolator transformInterpolator(scene);
+
+    // create (instance) VkBuffer
+    silk::InstanceBufferContext instanceBufferContext(deviceContext, MAX_FRAMES_IN_FLIGHT);
 
     struct CameraUBO
     {
@@ -316,6 +330,7 @@ int main()
     {
         cameraUBOBufferContexts.emplace_back(deviceContext);
     }
+    deviceContext.getMemoryAllocator().printStats();
 
     // create VkDescriptorPool
     VkDescriptorPool descriptorPool;
@@ -442,21 +457,29 @@ int main()
     {
         VkDevice device = deviceContext.getDevice();
 
-        const auto startTime = std::chrono::high_resolution_clock::now();
-        auto previousTime = startTime;
+        silk::FixedTimestep timestep(60.0);
         uint32_t currentFrame = 0;
         while(!glfwWindowShouldClose(window))
         {
             glfwPollEvents();
 
-            // update loop
-            auto currentTime = std::chrono::high_resolution_clock::now();
-            float deltaTime = std::chrono::duration<float>(currentTime - previousTime).count();
-            previousTime = currentTime;
-            // for (std::function<void(float)> fn : updateCallbacks)
-            // {
-            //     fn(deltaTime);
-            // }
+            // update loop, runs at a fixed rate independent of the frame rate. rendering can blend the last two
+            // simulated states with timestep.getAlpha()
+            for (uint32_t ticks = timestep.advance(); ticks > 0; ticks--)
+            {
+                transformInterpolator.beginTick();
+                const float deltaTime = timestep.getTickDuration();
+                scene.each<silk::Transform, const Spin>([deltaTime](silk::Transform& transform, const Spin& spin)
+                {
+                    // kept within [-pi, pi], an ever growing angle loses precision and leaves the range the SIMD
+                    // matrix path is accurate in. the interpolator blends across the wrap along the shorter arc
+                    transform.setRotation(std::remainder(transform.getRotation() + spin.speed * deltaTime, 2.0f * std::numbers::pi_v<float>));
+                });
+                // for (std::function<void(float)> fn : updateCallbacks)
+                // {
+                //     fn(timestep.getTickDuration());
+                // }
+            }
 
             updateCursorDelta(window);
 
@@ -511,6 +534,10 @@ int main()
 
                 vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
+                // update instances, the fence above guarantees the GPU is done with this frame's region
+                transformInterpolator.interpolate(timestep.getAlpha());
+                const uint32_t instanceCount = instanceBufferContext.update(currentFrame, transformInterpolator);
+
                 vkResetCommandBuffer(commandBuffers[currentFrame], 0);
 
                 // record command buffer
@@ -554,6 +581,7 @@ int main()
                     VkBuffer vertexBuffers[] = { vertexBufferContext.getBuffer() };
                     VkDeviceSize offsets[] = { 0 };
                     vkCmdBindVertexBuffers(commandBuffers[currentFrame], 0, 1, vertexBuffers, offsets);
+                    instanceBufferContext.bind(commandBuffers[currentFrame], currentFrame);
 
                     vkCmdBindIndexBuffer(commandBuffers[currentFrame], indexBufferContext.getBuffer(), 0, VK_INDEX_TYPE_UINT16);
 
@@ -561,7 +589,7 @@ int main()
 
                     vkCmdPushConstants(commandBuffers[currentFrame], pipelineContext.getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ModelPC), &modelPC);
 
-                    vkCmdDrawIndexed(commandBuffers[currentFrame], indices.size(), 1, 0, 0, 0);
+                    vkCmdDrawIndexed(commandBuffers[currentFrame], indices.size(), instanceCount, 0, 0, 0);
 
                 vkCmdEndRenderPass(commandBuffers[currentFrame]);
 
@@ -627,13 +655,6 @@ int main()
     // destroy VkDescriptorPool
     vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 
-    // destroy (instance) VkBuffer
-    // for (size_t i = 0; i < static_cast<size_t>(MAX_FRAMES_IN_FLIGHT); i++)
-    // {
-    //     vkFreeMemory(device, instanceBuffersMemory[i], nullptr);
-    //     vkDestroyBuffer(device, instanceBuffers[i], nullptr);
-    // }
-
     // destroy VkCommandPool
     vkDestroyCommandPool(device, commandPool, nullptr);
 
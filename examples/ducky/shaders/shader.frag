@@ -4,6 +4,7 @@ layout(location = 0) in vec3 viewDirVS;
 layout(location = 1) in vec3 normalDirVS;
 layout(location = 2) in vec2 uv;
 layout(location = 3) in vec3 lightDirVS;
+layout(location = 4) in vec4 tint;
 
 layout(location = 0) out vec4 outColor;
 
@@ -23,7 +24,7 @@ void main()
     if (diffuse > 0.0)
         spec = pow(max(dot(N, H), 0.0), shininess);
 
-    vec3 texColor = texture(texSampler, uv).xyz; 
+    vec3 texColor = texture(texSampler, uv).xyz * tint.rgb;
 
     float ambient = 0.01;
     vec3 color = texColor * (diffuse + ambient) + vec3(spec);
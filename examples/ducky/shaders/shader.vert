@@ -14,17 +14,24 @@ layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inUV;
 
+layout(location = 8) in mat4 inInstanceModel;
+layout(location = 12) in vec4 inInstanceTint;
+
 layout(location = 0) out vec3 viewDirVS;
 layout(location = 1) out vec3 normalDirVS;
 layout(location = 2) out vec2 uv;
 layout(location = 3) out vec3 lightDirVS;
+layout(location = 4) out vec4 tint;
 
 void main()
 {
-    vec4 fragPosVS = ubo.view * pc.model * vec4(inPosition, 1.0);
+    vec4 fragPosVS = ubo.view * pc.model * inInstanceModel * vec4(inPosition, 1.0);
     gl_Position = ubo.proj * fragPosVS;
     viewDirVS = -fragPosVS.xyz;
-    normalDirVS = (pc.normal * vec4(inNormal, 0.0)).xyz;
+    // instance Transforms may scale non-uniformly, so normals need the inverse transpose of the instance matrix
+    mat3 instanceNormal = transpose(inverse(mat3(inInstanceModel)));
+    normalDirVS = mat3(pc.normal) * instanceNormal * inNormal;
     uv = inUV;
+    tint = inInstanceTint;
     lightDirVS = (ubo.view * vec4(1,0,0,0)).xyz;
 }
\ No newline at end of file
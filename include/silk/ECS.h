@@ -1,163 +1,2147 @@
 #pragma once
 
+#include "silk/ThreadPool.h"
+#include "silk/PagedVector.h"
+
 #include <cstdint>
+#include <cstddef>
 #include <vector>
-#include <unordered_map>
-#include <stack>
+#include <array>
+#include <bit>
+#include <span>
+#include <map>
+#include <optional>
+#include <new>
+#include <algorithm>
 #include <memory>
+#include <memory_resource>
+#include <tuple>
+#include <atomic>
+#include <functional>
+#include <utility>
 #include <cassert>
+#include <stdexcept>
+#include <string>
 
 namespace silk
 {
     using Entity = uint32_t;
-    inline uint32_t nextComponentTypeID = 0;
+    // IDs are handed out on first use, so they depend on call order. StaticScene resolves its IDs at compile time instead
+    inline std::atomic<uint32_t> nextComponentTypeID = 0;
 
     template<typename T>
     uint32_t getComponentTypeID()
     {
-        static const uint32_t typeID = nextComponentTypeID++;
+        static const uint32_t typeID = nextComponentTypeID.fetch_add(1, std::memory_order_relaxed);
         return typeID;
     }
 
+    // fixed width set of component type IDs, one per entity in sparse scenes
+    struct ComponentMask
+    {
+        static constexpr uint32_t MAX_COMPONENT_TYPES = 128;
+        static constexpr uint32_t WORD_COUNT = MAX_COMPONENT_TYPES / 64;
+
+        std::array<uint64_t, WORD_COUNT> words{};
+
+        template <typename... T>
+        static ComponentMask of()
+        {
+            ComponentMask mask;
+            (mask.set(getComponentTypeID<T>()), ...);
+            return mask;
+        }
+
+        void set(uint32_t typeID)
+        {
+            checkTypeID(typeID);
+            words[typeID / 64] |= uint64_t(1) << (typeID % 64);
+        }
+
+        void reset(uint32_t typeID)
+        {
+            checkTypeID(typeID);
+            words[typeID / 64] &= ~(uint64_t(1) << (typeID % 64));
+        }
+
+        bool test(uint32_t typeID) const
+        {
+            return typeID < MAX_COMPONENT_TYPES && (words[typeID / 64] >> (typeID % 64)) & 1;
+        }
+
+        bool containsAll(const ComponentMask& other) const
+        {
+            for (uint32_t i = 0; i < WORD_COUNT; i++)
+            {
+                if ((words[i] & other.words[i]) != other.words[i])
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool operator==(const ComponentMask&) const = default;
+
+        ComponentMask& operator|=(const ComponentMask& other)
+        {
+            for (uint32_t i = 0; i < WORD_COUNT; i++)
+            {
+                words[i] |= other.words[i];
+            }
+            return *this;
+        }
+
+        // calls fn(typeID) for every set bit in ascending order
+        template <typename Fn>
+        void forEach(Fn&& fn) const
+        {
+            for (uint32_t i = 0; i < WORD_COUNT; i++)
+            {
+                for (uint64_t word = words[i]; word != 0; word &= word - 1)
+                {
+                    fn(i * 64 + static_cast<uint32_t>(std::countr_zero(word)));
+                }
+            }
+        }
+
+        // type IDs are program wide, so running out is a build problem and must not write past words in release builds
+        static void checkTypeID(uint32_t typeID)
+        {
+            if (typeID >= MAX_COMPONENT_TYPES)
+            {
+                throw std::runtime_error("Error: component type ID " + std::to_string(typeID) + " exceeds ComponentMask::MAX_COMPONENT_TYPES (" + std::to_string(MAX_COMPONENT_TYPES) + ")!");
+            }
+        }
+    };
+
+    // paged entity -> dense index lookup, a page is only allocated once an entity in its range is inserted
+    struct SparseIndex
+    {
+        static constexpr uint32_t PAGE_SIZE = 4096;
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+        std::vector<std::unique_ptr<uint32_t[]>> pages;
+
+        bool contains(Entity e) const
+        {
+            const size_t page = e / PAGE_SIZE;
+            return page < pages.size() && pages[page] && pages[page][e % PAGE_SIZE] != INVALID_INDEX;
+        }
+
+        uint32_t get(Entity e) const
+        {
+            assert(contains(e));
+            return pages[e / PAGE_SIZE][e % PAGE_SIZE];
+        }
+
+        void set(Entity e, uint32_t index)
+        {
+            const size_t page = e / PAGE_SIZE;
+            if (page >= pages.size())
+            {
+                pages.resize(page + 1);
+            }
+
+            if (!pages[page])
+            {
+                pages[page] = std::make_unique<uint32_t[]>(PAGE_SIZE);
+                std::fill_n(pages[page].get(), PAGE_SIZE, INVALID_INDEX);
+            }
+
+            pages[page][e % PAGE_SIZE] = index;
+        }
+
+        void erase(Entity e)
+        {
+            assert(contains(e));
+            pages[e / PAGE_SIZE][e % PAGE_SIZE] = INVALID_INDEX;
+        }
+    };
+
+    struct OwningGroup;
+
     struct BaseComponentPool
     {
+        // set while an owning group keeps this pool's group members packed at the front
+        OwningGroup* group = nullptr;
+
         virtual ~BaseComponentPool() = default;
+        virtual uint32_t indexOf(Entity e) const = 0;
+        // swaps two dense entries together with their owners and sparse index entries
+        virtual void swapEntries(uint32_t a, uint32_t b) = 0;
+        // moves the entry at order[i] to i for every i in order, entries past order.size() stay where they are
+        virtual void permute(std::span<const uint32_t> order) = 0;
         virtual void remove(Entity e) = 0;
+        // removes every entity in the span that has a component in this pool, entities without one are skipped
+        virtual void removeBulk(std::span<const Entity> entities) = 0;
         virtual bool has(Entity e) const = 0;
     };
 
+    // specialize with PAGED = true to keep a component type in fixed-size pages from the scene's arena. growing such a
+    // pool never moves its components, so references stay valid until that component or the one swapped in is removed
+    template <typename T>
+    struct ComponentTraits
+    {
+        static constexpr bool PAGED = false;
+    };
+
+    // final, so calls on a concrete pool are never dispatched virtually
     template <typename T>
-    struct ComponentPool : BaseComponentPool
+    struct ComponentPool final : BaseComponentPool
     {
-        std::vector<T> components;
+        using Storage = std::conditional_t<ComponentTraits<T>::PAGED, PagedVector<T>, std::vector<T>>;
+
+        explicit ComponentPool(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : components(makeStorage(resource)) {}
+
+        Storage components;
         std::vector<Entity> owners;
-        std::unordered_map<Entity, uint32_t> entityToComponentIndex;
+        SparseIndex entityToComponentIndex;
+        // change tick at which each component was added and last fetched mutably, parallel to components
+        std::vector<uint32_t> addedTicks;
+        std::vector<uint32_t> changedTicks;
+        // the owning scene's current change tick, pools without a scene record tick 0
+        const uint32_t* changeTick = nullptr;
+
+        uint32_t getChangeTick() const { return changeTick ? *changeTick : 0; }
+
+        template <typename... Args>
+        T& emplace(Entity e, Args&&... args)
+        {
+            assert(!has(e));
+            entityToComponentIndex.set(e, static_cast<uint32_t>(components.size()));
+            owners.push_back(e);
+            addedTicks.push_back(getChangeTick());
+            changedTicks.push_back(getChangeTick());
+            return components.emplace_back(std::forward<Args>(args)...);
+        }
+
+        void reserve(size_t capacity)
+        {
+            components.reserve(capacity);
+            owners.reserve(capacity);
+            addedTicks.reserve(capacity);
+            changedTicks.reserve(capacity);
+        }
 
         void remove(Entity e) override
         {
             assert(has(e));
 
-            uint32_t deletedIdx = entityToComponentIndex[e];
+            uint32_t deletedIdx = entityToComponentIndex.get(e);
             uint32_t lastIdx = static_cast<uint32_t>(components.size() - 1);
 
-            // copy last index into deleted index for density
-            components[deletedIdx] = components[lastIdx];
+            // move last index into deleted index for density
+            if (deletedIdx != lastIdx)
+            {
+                components[deletedIdx] = std::move(components[lastIdx]);
+                addedTicks[deletedIdx] = addedTicks[lastIdx];
+                changedTicks[deletedIdx] = changedTicks[lastIdx];
 
-            Entity movedEntity = owners[lastIdx];
-            owners[deletedIdx] = movedEntity;
-            entityToComponentIndex[movedEntity] = deletedIdx;
+                Entity movedEntity = owners[lastIdx];
+                owners[deletedIdx] = movedEntity;
+                entityToComponentIndex.set(movedEntity, deletedIdx);
+            }
 
             components.pop_back();
             owners.pop_back();
+            addedTicks.pop_back();
+            changedTicks.pop_back();
             entityToComponentIndex.erase(e);
         }
 
-        bool has(Entity e) const override
+        void removeBulk(std::span<const Entity> entities) override
         {
-            return entityToComponentIndex.count(e) > 0;
+            size_t removedCount = 0;
+            for (Entity e : entities)
+            {
+                removedCount += has(e);
+            }
+
+            // a few removals are cheapest as swap-and-pops, many are cheaper as one compaction pass
+            if (removedCount * 8 < components.size())
+            {
+                for (Entity e : entities)
+                {
+                    if (has(e))
+                    {
+                        remove(e);
+                    }
+                }
+                return;
+            }
+
+            for (Entity e : entities)
+            {
+                if (has(e))
+                {
+                    entityToComponentIndex.erase(e);
+                }
+            }
+
+            // entities still in the sparse index survive, they keep their relative order
+            size_t write = 0;
+            for (size_t read = 0; read < owners.size(); read++)
+            {
+                const Entity owner = owners[read];
+                if (!entityToComponentIndex.contains(owner))
+                {
+                    continue;
+                }
+
+                if (write != read)
+                {
+                    components[write] = std::move(components[read]);
+                    addedTicks[write] = addedTicks[read];
+                    changedTicks[write] = changedTicks[read];
+                    owners[write] = owner;
+                    entityToComponentIndex.set(owner, static_cast<uint32_t>(write));
+                }
+                write++;
+            }
+
+            while (components.size() > write)
+            {
+                components.pop_back();
+            }
+            owners.erase(owners.begin() + write, owners.end());
+            addedTicks.resize(write);
+            changedTicks.resize(write);
         }
-    };
 
-    class Scene
-    {
-    public:
-        template <typename T>
-        void addComponent(Entity e, T component)
+        // calls fn(std::span<const T>) for each contiguous run of components in dense order, one run unless T is paged
+        template <typename Fn>
+        void forEachBlock(Fn&& fn) const
         {
-            ComponentPool<T>& pool = getComponentPool<T>();
-            assert(!pool.has(e));
-            pool.entityToComponentIndex[e] = static_cast<uint32_t>(pool.components.size());
-            pool.owners.push_back(e);
-            pool.components.push_back(component);
+            if constexpr (ComponentTraits<T>::PAGED)
+            {
+                components.forEachBlock(fn);
+            }
+            else if (!components.empty())
+            {
+                fn(std::span<const T>(components));
+            }
         }
 
-        template <typename T>
-        bool hasComponent(Entity e)
+        // appends one copy of component per entity, none of the entities may already be in the pool
+        void addBulk(std::span<const Entity> entities, const T& component)
         {
-            const ComponentPool<T>& pool = getComponentPool<T>();
-            return pool.has(e);
+            const uint32_t firstIndex = static_cast<uint32_t>(components.size());
+            for (size_t i = 0; i < entities.size(); i++)
+            {
+                assert(!has(entities[i]));
+                entityToComponentIndex.set(entities[i], firstIndex + static_cast<uint32_t>(i));
+            }
+
+            owners.insert(owners.end(), entities.begin(), entities.end());
+            components.reserve(components.size() + entities.size());
+            for (size_t i = 0; i < entities.size(); i++)
+            {
+                components.push_back(component);
+            }
+            addedTicks.insert(addedTicks.end(), entities.size(), getChangeTick());
+            changedTicks.insert(changedTicks.end(), entities.size(), getChangeTick());
         }
 
-        template <typename T>
-        T& getComponent(Entity e)
+        bool has(Entity e) const override
         {
-            ComponentPool<T>& pool = getComponentPool<T>();
-            assert(pool.has(e));
-            return pool.components[pool.entityToComponentIndex[e]];
+            return entityToComponentIndex.contains(e);
         }
 
-        template <typename T>
-        void removeComponent(Entity e)
+        uint32_t indexOf(Entity e) const override
         {
-            ComponentPool<T>& pool = getComponentPool<T>();
-            pool.remove(e);
+            return entityToComponentIndex.get(e);
         }
-    
-        template <typename... T>
-        Entity createEntity(T&&... components)
+
+        void swapEntries(uint32_t a, uint32_t b) override
         {
-            Entity e;
-            if (!freedEntities.empty())
+            if (a == b)
             {
-                e = freedEntities.top();
-                freedEntities.pop();
+                return;
             }
-            else
+
+            using std::swap;
+            swap(components[a], components[b]);
+            std::swap(owners[a], owners[b]);
+            std::swap(addedTicks[a], addedTicks[b]);
+            std::swap(changedTicks[a], changedTicks[b]);
+            entityToComponentIndex.set(owners[a], a);
+            entityToComponentIndex.set(owners[b], b);
+        }
+
+        void permute(std::span<const uint32_t> order) override
+        {
+            // follows each cycle of the permutation once, costing one move per entry plus one per cycle
+            std::vector<bool> placed(order.size());
+            for (uint32_t start = 0; start < order.size(); start++)
             {
-                e = nextEntityID++;
+                if (placed[start] || order[start] == start)
+                {
+                    continue;
+                }
+
+                T component = std::move(components[start]);
+                const Entity owner = owners[start];
+                const uint32_t addedTick = addedTicks[start];
+                const uint32_t changedTick = changedTicks[start];
+
+                uint32_t current = start;
+                for (uint32_t next = order[current]; next != start; next = order[current])
+                {
+                    components[current] = std::move(components[next]);
+                    owners[current] = owners[next];
+                    addedTicks[current] = addedTicks[next];
+                    changedTicks[current] = changedTicks[next];
+                    entityToComponentIndex.set(owners[current], current);
+                    placed[current] = true;
+                    current = next;
+                }
+
+                components[current] = std::move(component);
+                owners[current] = owner;
+                addedTicks[current] = addedTick;
+                changedTicks[current] = changedTick;
+                entityToComponentIndex.set(owner, current);
+                placed[current] = true;
             }
+        }
 
-            (addComponent(e, std::forward<T>(components)), ...);
+        // mutable access marks the component as changed
+        T& get(Entity e)
+        {
+            return getAt(entityToComponentIndex.get(e));
+        }
 
-            return e;
+        const T& get(Entity e) const
+        {
+            return components[entityToComponentIndex.get(e)];
         }
 
-        void deleteEntity(Entity e)
+        T& getAt(size_t index)
         {
-            for (auto& pool : componentPools)
+            changedTicks[index] = getChangeTick();
+            return components[index];
+        }
+    private:
+        static Storage makeStorage([[maybe_unused]] std::pmr::memory_resource* resource)
+        {
+            if constexpr (ComponentTraits<T>::PAGED)
+            {
+                return Storage(resource);
+            }
+            else
+            {
+                return Storage();
+            }
+        }
+    };
+
+    // non-owning, allocation-free iteration over entities that have every component in T...
+    // a const T yields a const reference. adding or removing components of T... while iterating is not allowed
+    template <typename... T>
+    class View
+    {
+    public:
+        using Pools = std::tuple<ComponentPool<std::remove_const_t<T>>*...>;
+
+        class Iterator
+        {
+        public:
+            Iterator(const View* view, size_t index) : view(view), index(index) { skipInvalid(); }
+
+            std::tuple<Entity, T&...> operator*() const
             {
-                if (pool && pool->has(e))
+                Entity e = (*view->owners)[index];
+                return std::tuple<Entity, T&...>(e, fetch<T>(std::get<ComponentPool<std::remove_const_t<T>>*>(view->pools), e)...);
+            }
+
+            Iterator& operator++()
+            {
+                index++;
+                skipInvalid();
+                return *this;
+            }
+
+            bool operator==(const Iterator& other) const { return index == other.index; }
+        private:
+            const View* view;
+            size_t index;
+
+            void skipInvalid()
+            {
+                while (index < view->owners->size() && !view->contains((*view->owners)[index]))
                 {
-                    pool->remove(e);
+                    index++;
                 }
             }
-            freedEntities.push(e);
+        };
+
+        explicit View(Pools pools) : pools(pools)
+        {
+            // drive iteration with the smallest pool, the others are only probed
+            size_t smallestSize = SIZE_MAX;
+            [&]<size_t... I>(std::index_sequence<I...>)
+            {
+                (
+                    [&]
+                    {
+                        const std::vector<Entity>& poolOwners = std::get<I>(pools)->owners;
+                        if (poolOwners.size() < smallestSize)
+                        {
+                            smallestSize = poolOwners.size();
+                            drivingPool = I;
+                            owners = &poolOwners;
+                        }
+                    }(),
+                    ...
+                );
+            }(std::index_sequence_for<T...>{});
         }
 
-        template <typename... T>
-        std::vector<Entity> query()
+        Iterator begin() const { return Iterator(this, 0); }
+
+        Iterator end() const { return Iterator(this, owners->size()); }
+
+        bool contains(Entity e) const
         {
-            std::vector<Entity> entities;
-            const auto& baseOwners = getComponentPool<typename std::tuple_element<0, std::tuple<T...>>::type>().owners;
+            return (std::get<ComponentPool<std::remove_const_t<T>>*>(pools)->has(e) && ...);
+        }
 
-            for (Entity e : baseOwners)
+        // number of dense entries of the driving pool, an upper bound of the entities visited
+        size_t getDrivingSize() const { return owners->size(); }
+
+        // fn is called as fn(Entity, T&...) or fn(T&...)
+        template <typename Fn>
+        void each(Fn&& fn) const
+        {
+            eachInRange(0, getDrivingSize(), fn);
+        }
+
+        // only visits entries [begin, end) of the driving pool's dense arrays
+        template <typename Fn>
+        void eachInRange(size_t begin, size_t end, Fn&& fn) const
+        {
+            [&]<size_t... I>(std::index_sequence<I...>)
+            {
+                ((drivingPool == I ? (eachDrivenBy<I>(fn, begin, end), true) : false) || ...);
+            }(std::index_sequence_for<T...>{});
+        }
+    private:
+        Pools pools;
+        const std::vector<Entity>* owners = nullptr;
+        size_t drivingPool = 0;
+
+        template <size_t Driver, typename Fn>
+        void eachDrivenBy(Fn& fn, size_t begin, size_t end) const
+        {
+            auto* driver = std::get<Driver>(pools);
+            for (size_t i = begin; i < end; i++)
             {
-                if ((hasComponent<T>(e) && ...))
+                const Entity e = driver->owners[i];
+                if (!contains(e))
                 {
-                    entities.push_back(e);
+                    continue;
                 }
+
+                // the driving pool is indexed directly, the rest go through their sparse index
+                [&]<size_t... I>(std::index_sequence<I...>)
+                {
+                    if constexpr (std::is_invocable_v<Fn&, Entity, T&...>)
+                    {
+                        fn(e, get<I, Driver>(e, i)...);
+                    }
+                    else
+                    {
+                        fn(get<I, Driver>(e, i)...);
+                    }
+                }(std::index_sequence_for<T...>{});
             }
+        }
 
-            return entities;
+        // only non-const components are marked as changed
+        template <typename U>
+        static U& fetch(ComponentPool<std::remove_const_t<U>>* pool, Entity e)
+        {
+            if constexpr (std::is_const_v<U>)
+            {
+                return std::as_const(*pool).get(e);
+            }
+            else
+            {
+                return pool->get(e);
+            }
         }
 
-    private:
-        std::stack<Entity> freedEntities;
-        Entity nextEntityID = 0;
-        std::vector<std::unique_ptr<BaseComponentPool>> componentPools;
+        template <size_t I, size_t Driver>
+        std::tuple_element_t<I, std::tuple<T...>>& get(Entity e, size_t driverIndex) const
+        {
+            using U = std::tuple_element_t<I, std::tuple<T...>>;
+            if constexpr (I != Driver)
+            {
+                return fetch<U>(std::get<I>(pools), e);
+            }
+            else if constexpr (std::is_const_v<U>)
+            {
+                return std::get<I>(pools)->components[driverIndex];
+            }
+            else
+            {
+                return std::get<I>(pools)->getAt(driverIndex);
+            }
+        }
+    };
 
-        template <typename T>
-        inline ComponentPool<T>& getComponentPool()
+    // the first size entries of every owned pool belong to entities that have all of the group's components,
+    // index i refers to the same entity in each of them
+    struct OwningGroup
+    {
+        ComponentMask mask;
+        std::vector<BaseComponentPool*> pools;
+        uint32_t size = 0;
+
+        bool contains(Entity e) const
         {
-            const uint32_t componentTypeID = getComponentTypeID<T>();
+            return pools[0]->has(e) && pools[0]->indexOf(e) < size;
+        }
 
-            if (componentTypeID >= static_cast<uint32_t>(componentPools.size()))
+        // e must have every owned component
+        void enter(Entity e)
+        {
+            if (contains(e))
             {
-                componentPools.resize(componentTypeID + 1);
-                componentPools[componentTypeID] = std::make_unique<ComponentPool<T>>();
+                return;
             }
 
-            return *static_cast<ComponentPool<T>*>(componentPools[componentTypeID].get());
+            for (BaseComponentPool* pool : pools)
+            {
+                pool->swapEntries(pool->indexOf(e), size);
+            }
+            size++;
+        }
+
+        void leave(Entity e)
+        {
+            if (!contains(e))
+            {
+                return;
+            }
+
+            size--;
+            for (BaseComponentPool* pool : pools)
+            {
+                pool->swapEntries(pool->indexOf(e), size);
+            }
+        }
+    };
+
+    // iterates the packed front of the pools owned by a group, no sparse lookups are needed.
+    // a const T yields a const reference. adding or removing components of T... while iterating is not allowed
+    template <typename... T>
+    class Group
+    {
+    public:
+        using Pools = std::tuple<ComponentPool<std::remove_const_t<T>>*...>;
+
+        Group(Pools pools, const OwningGroup* group) : pools(pools), group(group) {}
+
+        size_t size() const { return group->size; }
+
+        // fn is called as fn(Entity, T&...) or fn(T&...)
+        template <typename Fn>
+        void each(Fn&& fn) const
+        {
+            eachInRange(0, size(), fn);
         }
+
+        template <typename Fn>
+        void eachInRange(size_t begin, size_t end, Fn&& fn) const
+        {
+            const std::vector<Entity>& owners = std::get<0>(pools)->owners;
+            for (size_t i = begin; i < end; i++)
+            {
+                if constexpr (std::is_invocable_v<Fn&, Entity, T&...>)
+                {
+                    fn(owners[i], get<T>(i)...);
+                }
+                else
+                {
+                    fn(get<T>(i)...);
+                }
+            }
+        }
+    private:
+        Pools pools;
+        const OwningGroup* group;
+
+        template <typename U>
+        U& get(size_t index) const
+        {
+            auto* pool = std::get<ComponentPool<std::remove_const_t<U>>*>(pools);
+            if constexpr (std::is_const_v<U>)
+            {
+                return pool->components[index];
+            }
+            else
+            {
+                return pool->getAt(index);
+            }
+        }
+    };
+
+    // type-erased description of a component type for storages that move components without knowing T
+    struct ComponentTypeInfo
+    {
+        uint32_t typeID;
+        size_t size;
+        size_t alignment;
+        void (*moveConstruct)(void* dst, void* src);
+        void (*destroy)(void* ptr);
+    };
+
+    template <typename T>
+    const ComponentTypeInfo& getComponentTypeInfo()
+    {
+        static const ComponentTypeInfo info{
+            getComponentTypeID<T>(),
+            sizeof(T),
+            alignof(T),
+            [](void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); },
+            [](void* ptr) { static_cast<T*>(ptr)->~T(); }
+        };
+        return info;
+    }
+
+    // fixed-size block of archetype rows, laid out SoA: [Entity x capacity][column 0 x capacity][column 1 x capacity]...
+    struct ArchetypeChunk
+    {
+        static constexpr size_t SIZE = 16 * 1024;
+        static constexpr size_t ALIGNMENT = 64;
+
+        struct AlignedDelete
+        {
+            void operator()(std::byte* ptr) const { ::operator delete(ptr, std::align_val_t(ALIGNMENT)); }
+        };
+
+        std::unique_ptr<std::byte, AlignedDelete> data;
+        uint32_t count = 0;
+
+        explicit ArchetypeChunk(size_t bytes) : data(static_cast<std::byte*>(::operator new(bytes, std::align_val_t(ALIGNMENT)))) {}
+    };
+
+    // every entity with exactly the component types in `signature`, packed into chunks where only the last is partially filled
+    struct Archetype
+    {
+        std::vector<uint32_t> signature;
+        std::vector<const ComponentTypeInfo*> columns;
+        std::vector<size_t> columnOffsets;
+        std::vector<int32_t> typeToColumn;
+        std::vector<ArchetypeChunk> chunks;
+        size_t chunkBytes = ArchetypeChunk::SIZE;
+        uint32_t chunkCapacity = 0;
+
+        // cached transitions when a component type ID is added / removed
+        std::vector<Archetype*> addEdges;
+        std::vector<Archetype*> removeEdges;
+
+        explicit Archetype(std::vector<const ComponentTypeInfo*> sortedColumns) : columns(std::move(sortedColumns))
+        {
+            size_t rowSize = sizeof(Entity);
+            size_t padding = 0;
+            for (size_t i = 0; i < columns.size(); i++)
+            {
+                signature.push_back(columns[i]->typeID);
+                rowSize += columns[i]->size;
+                padding += columns[i]->alignment;
+            }
+
+            // components too large for a single chunk get a chunk sized for one row
+            chunkCapacity = static_cast<uint32_t>(ArchetypeChunk::SIZE > padding ? (ArchetypeChunk::SIZE - padding) / rowSize : 0);
+            if (chunkCapacity == 0)
+            {
+                chunkCapacity = 1;
+                chunkBytes = rowSize + padding;
+            }
+
+            size_t offset = sizeof(Entity) * chunkCapacity;
+            for (const ComponentTypeInfo* info : columns)
+            {
+                offset = (offset + info->alignment - 1) / info->alignment * info->alignment;
+                columnOffsets.push_back(offset);
+                offset += info->size * chunkCapacity;
+
+                if (info->typeID >= typeToColumn.size())
+                {
+                    typeToColumn.resize(info->typeID + 1, -1);
+                }
+                typeToColumn[info->typeID] = static_cast<int32_t>(columnOffsets.size() - 1);
+            }
+            assert(offset <= chunkBytes);
+        }
+
+        Archetype(const Archetype&) = delete;
+        Archetype& operator=(const Archetype&) = delete;
+
+        ~Archetype()
+        {
+            for (ArchetypeChunk& chunk : chunks)
+            {
+                for (size_t column = 0; column < columns.size(); column++)
+                {
+                    for (uint32_t row = 0; row < chunk.count; row++)
+                    {
+                        columns[column]->destroy(getComponent(chunk, row, column));
+                    }
+                }
+            }
+        }
+
+        int32_t getColumn(uint32_t typeID) const { return typeID < typeToColumn.size() ? typeToColumn[typeID] : -1; }
+
+        Entity* getEntities(ArchetypeChunk& chunk) const { return reinterpret_cast<Entity*>(chunk.data.get()); }
+
+        void* getComponent(ArchetypeChunk& chunk, uint32_t row, size_t column) const
+        {
+            return chunk.data.get() + columnOffsets[column] + columns[column]->size * row;
+        }
+
+        template <typename T>
+        T* getColumnData(ArchetypeChunk& chunk, size_t column) const
+        {
+            return reinterpret_cast<T*>(chunk.data.get() + columnOffsets[column]);
+        }
+
+        // appends an uninitialized row owned by e and returns its (chunk, row)
+        std::pair<uint32_t, uint32_t> allocateRow(Entity e)
+        {
+            if (chunks.empty() || chunks.back().count == chunkCapacity)
+            {
+                chunks.emplace_back(chunkBytes);
+            }
+
+            ArchetypeChunk& chunk = chunks.back();
+            const uint32_t row = chunk.count++;
+            getEntities(chunk)[row] = e;
+            return { static_cast<uint32_t>(chunks.size() - 1), row };
+        }
+
+        // destroys a row and fills the hole with the last row, returns the entity that moved into (chunkIdx, row) if any
+        std::optional<Entity> removeRow(uint32_t chunkIdx, uint32_t row)
+        {
+            ArchetypeChunk& chunk = chunks[chunkIdx];
+            ArchetypeChunk& last = chunks.back();
+            const uint32_t lastRow = last.count - 1;
+
+            std::optional<Entity> movedEntity;
+            for (size_t column = 0; column < columns.size(); column++)
+            {
+                void* dst = getComponent(chunk, row, column);
+                columns[column]->destroy(dst);
+
+                if (&chunk != &last || row != lastRow)
+                {
+                    void* src = getComponent(last, lastRow, column);
+                    columns[column]->moveConstruct(dst, src);
+                    columns[column]->destroy(src);
+                }
+            }
+
+            if (&chunk != &last || row != lastRow)
+            {
+                movedEntity = getEntities(last)[lastRow];
+                getEntities(chunk)[row] = *movedEntity;
+            }
+
+            if (--last.count == 0)
+            {
+                chunks.pop_back();
+            }
+
+            return movedEntity;
+        }
+    };
+
+    // stores entities grouped by component signature, so multi-component iteration streams contiguous columns
+    class ArchetypeStorage
+    {
+    public:
+        ArchetypeStorage()
+        {
+            archetypes.push_back(std::make_unique<Archetype>(std::vector<const ComponentTypeInfo*>{}));
+            archetypeLookup[{}] = archetypes.back().get();
+        }
+
+        template <typename T, typename... Args>
+        T& emplace(Entity e, Args&&... args)
+        {
+            assert(!has<T>(e));
+            const ComponentTypeInfo& info = getComponentTypeInfo<T>();
+            EntityLocation& location = getLocation(e);
+
+            Archetype* src = location.archetype;
+            if (info.typeID >= src->addEdges.size())
+            {
+                src->addEdges.resize(info.typeID + 1, nullptr);
+            }
+
+            if (!src->addEdges[info.typeID])
+            {
+                std::vector<const ComponentTypeInfo*> columns = src->columns;
+                columns.insert(std::upper_bound(columns.begin(), columns.end(), &info, compareTypeID), &info);
+                src->addEdges[info.typeID] = getArchetype(std::move(columns));
+            }
+
+            Archetype* dst = src->addEdges[info.typeID];
+            moveEntity(e, dst);
+            return *new (dst->getComponent(dst->chunks[location.chunk], location.row, dst->getColumn(info.typeID))) T(std::forward<Args>(args)...);
+        }
+
+        // places entities without components directly into the archetype of T..., one copy of each component per entity
+        template <typename... T>
+        void addBulk(std::span<const Entity> entities, const T&... components)
+        {
+            std::vector<const ComponentTypeInfo*> columns{ &getComponentTypeInfo<T>()... };
+            std::sort(columns.begin(), columns.end(), compareTypeID);
+            Archetype* archetype = getArchetype(std::move(columns));
+            const int32_t columnIndices[] = { archetype->getColumn(getComponentTypeID<T>())... };
+
+            if (!entities.empty())
+            {
+                const Entity maxEntity = *std::max_element(entities.begin(), entities.end());
+                if (maxEntity >= locations.size())
+                {
+                    locations.resize(static_cast<size_t>(maxEntity) + 1);
+                }
+            }
+
+            for (Entity e : entities)
+            {
+                assert(!locations[e].archetype || locations[e].archetype->columns.empty());
+
+                if (archetype->columns.empty())
+                {
+                    locations[e] = EntityLocation{ archetype, 0, 0 };
+                    continue;
+                }
+
+                auto [chunk, row] = archetype->allocateRow(e);
+                locations[e] = EntityLocation{ archetype, chunk, row };
+                [&]<size_t... I>(std::index_sequence<I...>)
+                {
+                    (new (archetype->getComponent(archetype->chunks[chunk], row, columnIndices[I])) T(components), ...);
+                }(std::index_sequence_for<T...>{});
+            }
+        }
+
+        template <typename T>
+        void remove(Entity e)
+        {
+            assert(has<T>(e));
+            const uint32_t typeID = getComponentTypeID<T>();
+            Archetype* src = locations[e].archetype;
+            if (typeID >= src->removeEdges.size())
+            {
+                src->removeEdges.resize(typeID + 1, nullptr);
+            }
+
+            if (!src->removeEdges[typeID])
+            {
+                std::vector<const ComponentTypeInfo*> columns = src->columns;
+                columns.erase(columns.begin() + src->getColumn(typeID));
+                src->removeEdges[typeID] = getArchetype(std::move(columns));
+            }
+
+            moveEntity(e, src->removeEdges[typeID]);
+        }
+
+        template <typename T>
+        bool has(Entity e) const
+        {
+            return e < locations.size() && locations[e].archetype && locations[e].archetype->getColumn(getComponentTypeID<T>()) >= 0;
+        }
+
+        template <typename T>
+        T& get(Entity e)
+        {
+            assert(has<T>(e));
+            const EntityLocation& location = locations[e];
+            Archetype* archetype = location.archetype;
+            return *static_cast<T*>(archetype->getComponent(archetype->chunks[location.chunk], location.row, archetype->getColumn(getComponentTypeID<T>())));
+        }
+
+        // component type IDs of e in ascending order, empty for entities without components
+        std::span<const uint32_t> getSignature(Entity e) const
+        {
+            if (e >= locations.size() || !locations[e].archetype)
+            {
+                return {};
+            }
+            return locations[e].archetype->signature;
+        }
+
+        void destroy(Entity e)
+        {
+            if (e >= locations.size() || !locations[e].archetype)
+            {
+                return;
+            }
+
+            removeFromArchetype(locations[e]);
+            locations[e] = EntityLocation{};
+        }
+
+        // fn is called as fn(Entity, T&...) or fn(T&...) for every row of every archetype containing T...
+        template <typename... T, typename Fn>
+        void each(Fn&& fn)
+        {
+            const uint32_t typeIDs[] = { getComponentTypeID<std::remove_const_t<T>>()... };
+            for (const auto& archetype : archetypes)
+            {
+                int32_t columns[sizeof...(T)];
+                if (!matchColumns(*archetype, typeIDs, columns))
+                {
+                    continue;
+                }
+
+                for (ArchetypeChunk& chunk : archetype->chunks)
+                {
+                    eachInChunk<T...>(*archetype, chunk, columns, fn);
+                }
+            }
+        }
+
+        // chunks are the unit of work, grainSize is rounded to whole chunks
+        template <typename... T, typename Fn>
+        void parallelEach(ThreadPool& threadPool, Fn&& fn, size_t grainSize)
+        {
+            const uint32_t typeIDs[] = { getComponentTypeID<std::remove_const_t<T>>()... };
+            struct ChunkRef
+            {
+                Archetype* archetype;
+                ArchetypeChunk* chunk;
+                int32_t columns[sizeof...(T)];
+            };
+
+            std::vector<ChunkRef> chunks;
+            size_t rows = 0;
+            for (const auto& archetype : archetypes)
+            {
+                ChunkRef ref{ archetype.get(), nullptr, {} };
+                if (!matchColumns(*archetype, typeIDs, ref.columns))
+                {
+                    continue;
+                }
+
+                for (ArchetypeChunk& chunk : archetype->chunks)
+                {
+                    ref.chunk = &chunk;
+                    chunks.push_back(ref);
+                    rows += chunk.count;
+                }
+            }
+
+            if (chunks.empty())
+            {
+                return;
+            }
+
+            const size_t rowsPerChunk = std::max<size_t>(rows / chunks.size(), 1);
+            threadPool.parallelFor(chunks.size(), (grainSize + rowsPerChunk - 1) / rowsPerChunk, [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    eachInChunk<T...>(*chunks[i].archetype, *chunks[i].chunk, chunks[i].columns, fn);
+                }
+            });
+        }
+    private:
+        struct EntityLocation
+        {
+            Archetype* archetype = nullptr;
+            uint32_t chunk = 0;
+            uint32_t row = 0;
+        };
+
+        std::vector<std::unique_ptr<Archetype>> archetypes;
+        std::map<std::vector<uint32_t>, Archetype*> archetypeLookup;
+        std::vector<EntityLocation> locations;
+
+        static bool compareTypeID(const ComponentTypeInfo* a, const ComponentTypeInfo* b) { return a->typeID < b->typeID; }
+
+        template <size_t N>
+        static bool matchColumns(const Archetype& archetype, const uint32_t (&typeIDs)[N], int32_t (&columns)[N])
+        {
+            for (size_t i = 0; i < N; i++)
+            {
+                columns[i] = archetype.getColumn(typeIDs[i]);
+                if (columns[i] < 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        template <typename... T, typename Fn>
+        static void eachInChunk(const Archetype& archetype, ArchetypeChunk& chunk, const int32_t* columns, Fn& fn)
+        {
+            [&]<size_t... I>(std::index_sequence<I...>)
+            {
+                const Entity* entities = archetype.getEntities(chunk);
+                std::tuple<T*...> data(archetype.template getColumnData<T>(chunk, columns[I])...);
+                for (uint32_t row = 0; row < chunk.count; row++)
+                {
+                    if constexpr (std::is_invocable_v<Fn&, Entity, T&...>)
+                    {
+                        fn(entities[row], std::get<I>(data)[row]...);
+                    }
+                    else
+                    {
+                        fn(std::get<I>(data)[row]...);
+                    }
+                }
+            }(std::index_sequence_for<T...>{});
+        }
+
+        EntityLocation& getLocation(Entity e)
+        {
+            if (e >= locations.size())
+            {
+                locations.resize(e + 1);
+            }
+
+            // entities without components live in the empty archetype, which never allocates rows
+            if (!locations[e].archetype)
+            {
+                locations[e].archetype = archetypes[0].get();
+            }
+
+            return locations[e];
+        }
+
+        Archetype* getArchetype(std::vector<const ComponentTypeInfo*> columns)
+        {
+            std::vector<uint32_t> signature;
+            for (const ComponentTypeInfo* info : columns)
+            {
+                signature.push_back(info->typeID);
+            }
+
+            auto it = archetypeLookup.find(signature);
+            if (it != archetypeLookup.end())
+            {
+                return it->second;
+            }
+
+            archetypes.push_back(std::make_unique<Archetype>(std::move(columns)));
+            archetypeLookup[std::move(signature)] = archetypes.back().get();
+            return archetypes.back().get();
+        }
+
+        // moves every component the two archetypes share, components only dst has are left uninitialized
+        void moveEntity(Entity e, Archetype* dst)
+        {
+            EntityLocation& location = locations[e];
+            Archetype* src = location.archetype;
+
+            EntityLocation newLocation{ dst, 0, 0 };
+            if (!dst->columns.empty())
+            {
+                auto [chunk, row] = dst->allocateRow(e);
+                newLocation.chunk = chunk;
+                newLocation.row = row;
+
+                for (size_t column = 0; column < src->columns.size(); column++)
+                {
+                    const int32_t dstColumn = dst->getColumn(src->columns[column]->typeID);
+                    if (dstColumn >= 0)
+                    {
+                        src->columns[column]->moveConstruct(
+                            dst->getComponent(dst->chunks[chunk], row, dstColumn),
+                            src->getComponent(src->chunks[location.chunk], location.row, column)
+                        );
+                    }
+                }
+            }
+
+            removeFromArchetype(location);
+            location = newLocation;
+        }
+
+        void removeFromArchetype(const EntityLocation& location)
+        {
+            if (location.archetype->columns.empty())
+            {
+                return;
+            }
+
+            std::optional<Entity> movedEntity = location.archetype->removeRow(location.chunk, location.row);
+            if (movedEntity.has_value())
+            {
+                locations[*movedEntity].chunk = location.chunk;
+                locations[*movedEntity].row = location.row;
+            }
+        }
+    };
+
+    // query() filter matching entities whose T was fetched mutably after the given tick
+    template <typename T>
+    struct Changed {};
+
+    // query() filter matching entities that received T after the given tick
+    template <typename T>
+    struct Added {};
+
+    template <typename T>
+    struct QueryTerm
+    {
+        using Component = T;
+        static constexpr bool IS_FILTER = false;
+        static bool matches(const ComponentPool<T>&, Entity, uint32_t) { return true; }
+    };
+
+    template <typename T>
+    struct QueryTerm<Changed<T>>
+    {
+        using Component = T;
+        static constexpr bool IS_FILTER = true;
+        static bool matches(const ComponentPool<T>& pool, Entity e, uint32_t sinceTick)
+        {
+            return pool.changedTicks[pool.entityToComponentIndex.get(e)] > sinceTick;
+        }
+    };
+
+    template <typename T>
+    struct QueryTerm<Added<T>>
+    {
+        using Component = T;
+        static constexpr bool IS_FILTER = true;
+        static bool matches(const ComponentPool<T>& pool, Entity e, uint32_t sinceTick)
+        {
+            return pool.addedTicks[pool.entityToComponentIndex.get(e)] > sinceTick;
+        }
+    };
+
+    // unordered set of entities with O(1) insert, erase and lookup
+    class EntitySet
+    {
+    public:
+        bool contains(Entity e) const { return index.contains(e); }
+
+        void insert(Entity e)
+        {
+            if (!contains(e))
+            {
+                index.set(e, static_cast<uint32_t>(entities.size()));
+                entities.push_back(e);
+            }
+        }
+
+        void erase(Entity e)
+        {
+            if (!contains(e))
+            {
+                return;
+            }
+
+            const uint32_t position = index.get(e);
+            entities[position] = entities.back();
+            index.set(entities[position], position);
+            entities.pop_back();
+            index.erase(e);
+        }
+
+        void clear()
+        {
+            for (Entity e : entities)
+            {
+                index.erase(e);
+            }
+            entities.clear();
+        }
+
+        std::span<const Entity> getEntities() const { return entities; }
+        size_t size() const { return entities.size(); }
+        bool empty() const { return entities.empty(); }
+    private:
+        std::vector<Entity> entities;
+        SparseIndex index;
+    };
+
+    // accumulates the entities whose component was constructed, patched or destroyed since the last clear(), so derived
+    // data can be updated incrementally. an entity that lost the component moves from the changed to the destroyed set,
+    // one that got it back is in both, so consumers should process getDestroyed() before getChanged()
+    class Collector
+    {
+    public:
+        std::span<const Entity> getChanged() const { return changed.getEntities(); }
+        std::span<const Entity> getDestroyed() const { return destroyed.getEntities(); }
+
+        void clear()
+        {
+            changed.clear();
+            destroyed.clear();
+        }
+    private:
+        friend class Scene;
+
+        EntitySet changed;
+        EntitySet destroyed;
+    };
+
+    enum class ComponentEvent
+    {
+        Construct,  // fired right after the component was added
+        Update,     // fired after Scene::patchComponent()
+        Destroy     // fired right before the component is removed, it can still be read
+    };
+
+    // identifies a listener for Scene::disconnect()
+    struct Connection
+    {
+        uint32_t typeID;
+        ComponentEvent event;
+        uint32_t id;
+    };
+
+    enum class SortMode
+    {
+        Full,       // std::sort, for pools in arbitrary order
+        Insertion   // O(n + inversions), for pools that are still almost sorted from the previous frame
+    };
+
+    enum class StorageMode
+    {
+        Sparse,     // one ComponentPool per component type, fast add/remove
+        Archetype   // entities grouped by signature in SoA chunks, fast multi-component iteration
+    };
+
+    class SceneCommandBuffer;
+    class SceneSnapshot;
+
+    class Scene
+    {
+        friend class SceneCommandBuffer;
+        friend class SceneSnapshot;
+    public:
+        // pages of paged component pools come from componentMemory, or from an arena owned by the scene if it is null.
+        // either way they are all released together when the scene is destroyed
+        explicit Scene(StorageMode storageMode = StorageMode::Sparse, std::pmr::memory_resource* componentMemory = nullptr)
+            : componentMemory(componentMemory ? componentMemory : &componentArena)
+        {
+            if (storageMode == StorageMode::Archetype)
+            {
+                archetypeStorage = std::make_unique<ArchetypeStorage>();
+            }
+        }
+
+        StorageMode getStorageMode() const { return archetypeStorage ? StorageMode::Archetype : StorageMode::Sparse; }
+
+        // pool used by parallelEach, nullptr selects ThreadPool::getDefault()
+        void setThreadPool(ThreadPool* pool) { threadPool = pool; }
+
+        // while locked, creating/deleting entities and adding/removing components asserts.
+        // locks are counted so concurrently running systems can each hold one
+        void lockStructure() { structureLockCount.fetch_add(1, std::memory_order_relaxed); }
+
+        void unlockStructure()
+        {
+            [[maybe_unused]] const uint32_t previous = structureLockCount.fetch_sub(1, std::memory_order_relaxed);
+            assert(previous > 0);
+        }
+
+        bool isStructureLocked() const { return structureLockCount.load(std::memory_order_relaxed) > 0; }
+
+        // components added or fetched mutably are stamped with the current change tick. a system remembers the
+        // value returned by advanceChangeTick() after it ran and passes it to query() to see only later changes
+        uint32_t getChangeTick() const { return changeTick; }
+
+        uint32_t advanceChangeTick() { return changeTick++; }
+
+        // creates the storage for T... ahead of time, so later access from several threads never mutates the pool table
+        template <typename... T>
+        void registerComponents()
+        {
+            if (archetypeStorage)
+            {
+                (getComponentTypeInfo<T>(), ...);
+                return;
+            }
+
+            (getComponentPool<T>(), ...);
+        }
+
+        template <typename T>
+        void addComponent(Entity e, T component)
+        {
+            emplaceComponent<T>(e, std::move(component));
+        }
+
+        // constructs T in place from args
+        template <typename T, typename... Args>
+        T& emplaceComponent(Entity e, Args&&... args)
+        {
+            assert(!isStructureLocked());
+            if (archetypeStorage)
+            {
+                T& component = archetypeStorage->emplace<T>(e, std::forward<Args>(args)...);
+                emit(getComponentTypeID<T>(), ComponentEvent::Construct, e);
+                return component;
+            }
+
+            ComponentPool<T>& pool = getComponentPool<T>();
+            pool.emplace(e, std::forward<Args>(args)...);
+            ComponentMask& mask = getEntityMask(e);
+            mask.set(getComponentTypeID<T>());
+            if (pool.group && mask.containsAll(pool.group->mask))
+            {
+                pool.group->enter(e);
+            }
+            emit(getComponentTypeID<T>(), ComponentEvent::Construct, e);
+            return pool.get(e);
+        }
+
+        template <typename T>
+        bool hasComponent(Entity e)
+        {
+            if (archetypeStorage)
+            {
+                return archetypeStorage->has<T>(e);
+            }
+
+            const ComponentPool<T>& pool = getComponentPool<T>();
+            return pool.has(e);
+        }
+
+        // getComponent<T>() marks the component as changed, getComponent<const T>() only reads it
+        template <typename T>
+        T& getComponent(Entity e)
+        {
+            using Component = std::remove_const_t<T>;
+            if (archetypeStorage)
+            {
+                return archetypeStorage->get<Component>(e);
+            }
+
+            ComponentPool<Component>& pool = getComponentPool<Component>();
+            assert(pool.has(e));
+            if constexpr (std::is_const_v<T>)
+            {
+                return std::as_const(pool).get(e);
+            }
+            else
+            {
+                return pool.get(e);
+            }
+        }
+
+        // calls fn(T&) and notifies the Update listeners of T afterwards. listeners run on the calling thread, so T must
+        // not be patched from several threads at once while it has any
+        template <typename T, typename Fn>
+        T& patchComponent(Entity e, Fn&& fn)
+        {
+            T& component = getComponent<T>(e);
+            fn(component);
+            emit(getComponentTypeID<T>(), ComponentEvent::Update, e);
+            return component;
+        }
+
+        template <typename T>
+        void removeComponent(Entity e)
+        {
+            assert(!isStructureLocked());
+            emit(getComponentTypeID<T>(), ComponentEvent::Destroy, e);
+            if (archetypeStorage)
+            {
+                archetypeStorage->remove<T>(e);
+                return;
+            }
+
+            ComponentPool<T>& pool = getComponentPool<T>();
+            if (pool.group)
+            {
+                pool.group->leave(e);
+            }
+            pool.remove(e);
+            entityMasks[e].reset(getComponentTypeID<T>());
+        }
+    
+        template <typename... T>
+        Entity createEntity(T&&... components)
+        {
+            assert(!isStructureLocked());
+            Entity e;
+            if (!freedEntities.empty())
+            {
+                e = freedEntities.back();
+                freedEntities.pop_back();
+            }
+            else
+            {
+                e = nextEntityID++;
+            }
+
+            (emplaceComponent<std::decay_t<T>>(e, std::forward<T>(components)), ...);
+
+            return e;
+        }
+
+        void deleteEntity(Entity e)
+        {
+            assert(!isStructureLocked());
+            emitDestroyAll(e);
+            if (archetypeStorage)
+            {
+                archetypeStorage->destroy(e);
+            }
+            else if (e < entityMasks.size())
+            {
+                // only the pools the entity actually uses are touched
+                leaveGroups(e);
+                entityMasks[e].forEach([&](uint32_t typeID) { componentPools[typeID]->remove(e); });
+                entityMasks[e] = {};
+            }
+            freedEntities.push_back(e);
+        }
+
+        // creates count entities that each get a copy of components..., filling every pool in one batch
+        template <typename... T>
+        std::vector<Entity> createEntities(size_t count, const T&... components)
+        {
+            assert(!isStructureLocked());
+            std::vector<Entity> entities(count);
+
+            // recycle freed IDs in the same order repeated createEntity() calls would
+            const size_t recycledCount = std::min(count, freedEntities.size());
+            std::copy(freedEntities.rbegin(), freedEntities.rbegin() + recycledCount, entities.begin());
+            freedEntities.resize(freedEntities.size() - recycledCount);
+            for (size_t i = recycledCount; i < count; i++)
+            {
+                entities[i] = nextEntityID++;
+            }
+
+            if (archetypeStorage)
+            {
+                archetypeStorage->addBulk<T...>(entities, components...);
+                emitConstructAll<T...>(entities);
+            }
+            else
+            {
+                (getComponentPool<T>().addBulk(entities, components), ...);
+
+                const ComponentMask mask = ComponentMask::of<T...>();
+                for (Entity e : entities)
+                {
+                    getEntityMask(e) = mask;
+                }
+
+                for (auto& group : groups)
+                {
+                    if (mask.containsAll(group->mask))
+                    {
+                        for (Entity e : entities)
+                        {
+                            group->enter(e);
+                        }
+                    }
+                }
+                emitConstructAll<T...>(entities);
+            }
+
+            return entities;
+        }
+
+        // every pool is visited once for the whole batch instead of once per entity
+        void deleteEntities(std::span<const Entity> entities)
+        {
+            assert(!isStructureLocked());
+            if (destroyListenerCount > 0)
+            {
+                for (Entity e : entities)
+                {
+                    emitDestroyAll(e);
+                }
+            }
+
+            if (archetypeStorage)
+            {
+                for (Entity e : entities)
+                {
+                    archetypeStorage->destroy(e);
+                }
+            }
+            else
+            {
+                ComponentMask used;
+                for (Entity e : entities)
+                {
+                    if (e < entityMasks.size())
+                    {
+                        // survivors keep their order during compaction, so the packed front stays intact
+                        leaveGroups(e);
+                        used |= entityMasks[e];
+                        entityMasks[e] = {};
+                    }
+                }
+                used.forEach([&](uint32_t typeID) { componentPools[typeID]->removeBulk(entities); });
+            }
+            freedEntities.insert(freedEntities.end(), entities.begin(), entities.end());
+        }
+
+        // listeners are called as fn(Scene&, Entity) and must not create or delete entities or add or remove components
+        template <typename T, typename Fn>
+        Connection onConstruct(Fn&& fn) { return connect(getComponentTypeID<T>(), ComponentEvent::Construct, std::forward<Fn>(fn)); }
+
+        template <typename T, typename Fn>
+        Connection onUpdate(Fn&& fn) { return connect(getComponentTypeID<T>(), ComponentEvent::Update, std::forward<Fn>(fn)); }
+
+        template <typename T, typename Fn>
+        Connection onDestroy(Fn&& fn) { return connect(getComponentTypeID<T>(), ComponentEvent::Destroy, std::forward<Fn>(fn)); }
+
+        void disconnect(Connection connection)
+        {
+            auto& list = signals[connection.typeID].get(connection.event);
+            auto it = std::find_if(list.begin(), list.end(), [&](const auto& listener) { return listener.first == connection.id; });
+            assert(it != list.end());
+            list.erase(it);
+            if (connection.event == ComponentEvent::Destroy)
+            {
+                destroyListenerCount--;
+            }
+        }
+
+        // returns a collector of T that lives as long as the scene
+        template <typename T>
+        Collector& collect()
+        {
+            Collector* collector = collectors.emplace_back(std::make_unique<Collector>()).get();
+            auto changed = [collector](Scene&, Entity e) { collector->changed.insert(e); };
+            onConstruct<T>(changed);
+            onUpdate<T>(changed);
+            onDestroy<T>([collector](Scene&, Entity e)
+            {
+                collector->changed.erase(e);
+                collector->destroyed.insert(e);
+            });
+            return *collector;
+        }
+
+        // T... may mix components with Changed<U> and Added<U> filters, which match entities whose U changed or was
+        // added after sinceTick. filters are only supported by sparse scenes
+        template <typename... T>
+        std::vector<Entity> query(uint32_t sinceTick = 0)
+        {
+            std::vector<Entity> entities;
+            if (archetypeStorage)
+            {
+                assert((!QueryTerm<T>::IS_FILTER && ...));
+                each<typename QueryTerm<T>::Component...>([&entities](Entity e, typename QueryTerm<T>::Component&...) { entities.push_back(e); });
+                return entities;
+            }
+
+            // walk the smallest pool's owners and reject with one mask test per entity
+            const std::vector<Entity>* owners[] = {&getComponentPool<typename QueryTerm<T>::Component>().owners...};
+            size_t smallest = 0;
+            for (size_t i = 1; i < sizeof...(T); i++)
+            {
+                if (owners[i]->size() < owners[smallest]->size())
+                {
+                    smallest = i;
+                }
+            }
+
+            const ComponentMask required = ComponentMask::of<typename QueryTerm<T>::Component...>();
+            for (Entity e : *owners[smallest])
+            {
+                if (entityMasks[e].containsAll(required) &&
+                    (QueryTerm<T>::matches(getComponentPool<typename QueryTerm<T>::Component>(), e, sinceTick) && ...))
+                {
+                    entities.push_back(e);
+                }
+            }
+            return entities;
+        }
+
+        // the first call reorders the pools of T... so entities having all of them are packed at the front, later
+        // additions and removals keep them packed. a pool can be owned by one group only, sparse scenes only
+        template <typename... T>
+        Group<T...> group()
+        {
+            static_assert(sizeof...(T) >= 2, "a group owns at least two component types");
+            assert(!archetypeStorage);
+
+            using Pools = typename Group<T...>::Pools;
+            const Pools pools(&getComponentPool<std::remove_const_t<T>>()...);
+            const ComponentMask mask = ComponentMask::of<std::remove_const_t<T>...>();
+            for (auto& existing : groups)
+            {
+                if (existing->mask == mask)
+                {
+                    return Group<T...>(pools, existing.get());
+                }
+            }
+
+            assert(!isStructureLocked());
+            auto owningGroup = std::make_unique<OwningGroup>();
+            owningGroup->mask = mask;
+            owningGroup->pools = {&getComponentPool<std::remove_const_t<T>>()...};
+            for (BaseComponentPool* pool : owningGroup->pools)
+            {
+                assert(!pool->group);
+                pool->group = owningGroup.get();
+            }
+
+            const std::vector<Entity>* owners[] = {&getComponentPool<std::remove_const_t<T>>().owners...};
+            const std::vector<Entity>& smallest = **std::min_element(std::begin(owners), std::end(owners),
+                [](const auto* a, const auto* b) { return a->size() < b->size(); });
+            for (size_t i = 0; i < smallest.size(); i++)
+            {
+                if (entityMasks[smallest[i]].containsAll(mask))
+                {
+                    owningGroup->enter(smallest[i]);
+                }
+            }
+
+            groups.push_back(std::move(owningGroup));
+            return Group<T...>(pools, groups.back().get());
+        }
+
+        // reorders the pool of T by compare(const T&, const T&) or compare(Entity, Entity). components, owners and
+        // the sparse index are permuted together in place. members of an owning group stay packed at the front,
+        // the other owned pools follow so the group stays in lockstep. sparse scenes only
+        template <typename T, typename Compare>
+        void sort(Compare compare, SortMode mode = SortMode::Full)
+        {
+            assert(!archetypeStorage);
+            assert(!isStructureLocked());
+            ComponentPool<T>& pool = getComponentPool<T>();
+
+            auto less = [&](uint32_t a, uint32_t b)
+            {
+                if constexpr (std::is_invocable_r_v<bool, Compare&, const T&, const T&>)
+                {
+                    return compare(std::as_const(pool.components[a]), std::as_const(pool.components[b]));
+                }
+                else
+                {
+                    return compare(pool.owners[a], pool.owners[b]);
+                }
+            };
+
+            std::vector<uint32_t> order(pool.components.size());
+            for (uint32_t i = 0; i < order.size(); i++)
+            {
+                order[i] = i;
+            }
+
+            const size_t groupSize = pool.group ? pool.group->size : 0;
+            sortIndices(order.begin(), order.begin() + groupSize, less, mode);
+            sortIndices(order.begin() + groupSize, order.end(), less, mode);
+
+            if (pool.group)
+            {
+                for (BaseComponentPool* owned : pool.group->pools)
+                {
+                    if (owned != &pool)
+                    {
+                        owned->permute(std::span<const uint32_t>(order).first(groupSize));
+                    }
+                }
+            }
+            pool.permute(order);
+        }
+
+        // reorders the pool of T so entities that also have U come first, in the order of U's pool.
+        // the rest keep their relative order. T must not be owned by a group, sparse scenes only
+        template <typename T, typename U>
+        void sortAs()
+        {
+            assert(!archetypeStorage);
+            assert(!isStructureLocked());
+            ComponentPool<T>& pool = getComponentPool<T>();
+            const ComponentPool<U>& from = getComponentPool<U>();
+            assert(!pool.group);
+
+            std::vector<uint32_t> order;
+            order.reserve(pool.components.size());
+            std::vector<bool> taken(pool.components.size());
+            for (Entity e : from.owners)
+            {
+                if (pool.has(e))
+                {
+                    const uint32_t index = pool.indexOf(e);
+                    order.push_back(index);
+                    taken[index] = true;
+                }
+            }
+
+            for (uint32_t i = 0; i < taken.size(); i++)
+            {
+                if (!taken[i])
+                {
+                    order.push_back(i);
+                }
+            }
+
+            pool.permute(order);
+        }
+
+        // read-only dense storage of T, components[i] belongs to entity owners[i]. sparse scenes only
+        template <typename T>
+        const ComponentPool<T>& getComponentStorage()
+        {
+            assert(!archetypeStorage);
+            return getComponentPool<T>();
+        }
+
+        // views iterate ComponentPools, archetype scenes iterate through each()
+        template <typename... T>
+        View<T...> view()
+        {
+            assert(!archetypeStorage);
+            return View<T...>(typename View<T...>::Pools(&getComponentPool<std::remove_const_t<T>>()...));
+        }
+
+        template <typename... T, typename Fn>
+        void each(Fn&& fn)
+        {
+            if (archetypeStorage)
+            {
+                archetypeStorage->each<T...>(std::forward<Fn>(fn));
+                return;
+            }
+
+            view<T...>().each(std::forward<Fn>(fn));
+        }
+
+        // like each(), but the driving pool's dense arrays (or the archetype chunks) are split into ranges of
+        // about grainSize entities that run concurrently. fn must be safe to call from several threads at once,
+        // the scene's structure is locked until every range has finished
+        template <typename... T, typename Fn>
+        void parallelEach(Fn&& fn, size_t grainSize = 4096)
+        {
+            ThreadPool& pool = threadPool ? *threadPool : ThreadPool::getDefault();
+            lockStructure();
+            try
+            {
+                if (archetypeStorage)
+                {
+                    archetypeStorage->parallelEach<T...>(pool, fn, grainSize);
+                }
+                else
+                {
+                    const View<T...> v = view<T...>();
+                    pool.parallelFor(v.getDrivingSize(), grainSize, [&](size_t begin, size_t end) { v.eachInRange(begin, end, fn); });
+                }
+            }
+            catch (...)
+            {
+                unlockStructure();
+                throw;
+            }
+            unlockStructure();
+        }
+
+    private:
+        using Listener = std::function<void(Scene&, Entity)>;
+
+        struct ComponentSignals
+        {
+            std::vector<std::pair<uint32_t, Listener>> construct;
+            std::vector<std::pair<uint32_t, Listener>> update;
+            std::vector<std::pair<uint32_t, Listener>> destroy;
+
+            std::vector<std::pair<uint32_t, Listener>>& get(ComponentEvent event)
+            {
+                return event == ComponentEvent::Construct ? construct : event == ComponentEvent::Update ? update : destroy;
+            }
+        };
+
+        // declared before the pools so it outlives them
+        std::pmr::monotonic_buffer_resource componentArena;
+        std::pmr::memory_resource* componentMemory;
+        std::unique_ptr<ArchetypeStorage> archetypeStorage;
+        ThreadPool* threadPool = nullptr;
+        std::atomic<uint32_t> structureLockCount = 0;
+        std::vector<Entity> freedEntities;
+        Entity nextEntityID = 0;
+        uint32_t changeTick = 1;
+        std::vector<std::unique_ptr<BaseComponentPool>> componentPools;
+        // sparse scenes only, indexed by entity
+        std::vector<ComponentMask> entityMasks;
+        std::vector<std::unique_ptr<OwningGroup>> groups;
+        // indexed by component type ID
+        std::vector<ComponentSignals> signals;
+        uint32_t nextListenerID = 0;
+        uint32_t destroyListenerCount = 0;
+        std::vector<std::unique_ptr<Collector>> collectors;
+
+        template <typename It, typename Less>
+        static void sortIndices(It first, It last, Less& less, SortMode mode)
+        {
+            if (mode == SortMode::Full)
+            {
+                std::sort(first, last, less);
+                return;
+            }
+
+            for (It i = first; i != last; ++i)
+            {
+                const uint32_t index = *i;
+                It j = i;
+                for (; j != first && less(index, *(j - 1)); --j)
+                {
+                    *j = *(j - 1);
+                }
+                *j = index;
+            }
+        }
+
+        Connection connect(uint32_t typeID, ComponentEvent event, Listener listener)
+        {
+            if (typeID >= signals.size())
+            {
+                signals.resize(typeID + 1);
+            }
+
+            const uint32_t id = nextListenerID++;
+            signals[typeID].get(event).emplace_back(id, std::move(listener));
+            if (event == ComponentEvent::Destroy)
+            {
+                destroyListenerCount++;
+            }
+            return Connection{ typeID, event, id };
+        }
+
+        void emit(uint32_t typeID, ComponentEvent event, Entity e)
+        {
+            if (typeID >= signals.size())
+            {
+                return;
+            }
+
+            for (auto& listener : signals[typeID].get(event))
+            {
+                listener.second(*this, e);
+            }
+        }
+
+        // Destroy for every component of e, before any of them is removed
+        void emitDestroyAll(Entity e)
+        {
+            if (destroyListenerCount == 0)
+            {
+                return;
+            }
+
+            if (archetypeStorage)
+            {
+                for (uint32_t typeID : archetypeStorage->getSignature(e))
+                {
+                    emit(typeID, ComponentEvent::Destroy, e);
+                }
+            }
+            else if (e < entityMasks.size())
+            {
+                entityMasks[e].forEach([&](uint32_t typeID) { emit(typeID, ComponentEvent::Destroy, e); });
+            }
+        }
+
+        template <typename... T>
+        void emitConstructAll(std::span<const Entity> entities)
+        {
+            if (signals.empty())
+            {
+                return;
+            }
+
+            for (Entity e : entities)
+            {
+                (emit(getComponentTypeID<T>(), ComponentEvent::Construct, e), ...);
+            }
+        }
+
+        void leaveGroups(Entity e)
+        {
+            for (auto& group : groups)
+            {
+                if (entityMasks[e].containsAll(group->mask))
+                {
+                    group->leave(e);
+                }
+            }
+        }
+
+        ComponentMask& getEntityMask(Entity e)
+        {
+            if (e >= entityMasks.size())
+            {
+                entityMasks.resize(static_cast<size_t>(e) + 1);
+            }
+            return entityMasks[e];
+        }
+
+        template <typename T>
+        inline ComponentPool<T>& getComponentPool()
+        {
+            const uint32_t componentTypeID = getComponentTypeID<T>();
+
+            if (componentTypeID >= static_cast<uint32_t>(componentPools.size()))
+            {
+                componentPools.resize(componentTypeID + 1);
+            }
+
+            // type IDs are global, so a lower ID may not have a pool in this scene yet
+            if (!componentPools[componentTypeID])
+            {
+                auto pool = std::make_unique<ComponentPool<T>>(componentMemory);
+                pool->changeTick = &changeTick;
+                componentPools[componentTypeID] = std::move(pool);
+            }
+
+            return *static_cast<ComponentPool<T>*>(componentPools[componentTypeID].get());
+        }
+    };
+
+    // sparse scene over a fixed set of component types. pools are held by value in a tuple and a component's type ID is
+    // its index in Components..., so every lookup is resolved at compile time and can inline into hot loops.
+    // offers the entity, component and iteration subset of Scene's API
+    template <typename... Components>
+    class StaticScene
+    {
+    public:
+        static_assert(sizeof...(Components) <= ComponentMask::MAX_COMPONENT_TYPES);
+
+        template <typename T>
+        static constexpr uint32_t getTypeIndex()
+        {
+            constexpr bool matches[] = { std::is_same_v<std::remove_const_t<T>, Components>... };
+            for (uint32_t i = 0; i < sizeof...(Components); i++)
+            {
+                if (matches[i])
+                {
+                    return i;
+                }
+            }
+            return UINT32_MAX;
+        }
+
+        StaticScene()
+        {
+            std::apply([this](auto&... pool) { ((pool.changeTick = &changeTick), ...); }, pools);
+        }
+
+        StaticScene(const StaticScene&) = delete;
+        StaticScene& operator=(const StaticScene&) = delete;
+
+        template <typename T>
+        ComponentPool<std::remove_const_t<T>>& getPool()
+        {
+            static_assert(getTypeIndex<T>() != UINT32_MAX, "T is not a component of this StaticScene");
+            return std::get<getTypeIndex<T>()>(pools);
+        }
+
+        uint32_t getChangeTick() const { return changeTick; }
+
+        uint32_t advanceChangeTick() { return changeTick++; }
+
+        template <typename... T>
+        Entity createEntity(T&&... components)
+        {
+            Entity e;
+            if (!freedEntities.empty())
+            {
+                e = freedEntities.back();
+                freedEntities.pop_back();
+            }
+            else
+            {
+                e = nextEntityID++;
+                entityMasks.emplace_back();
+            }
+
+            (emplaceComponent<std::decay_t<T>>(e, std::forward<T>(components)), ...);
+
+            return e;
+        }
+
+        void deleteEntity(Entity e)
+        {
+            [&]<size_t... I>(std::index_sequence<I...>)
+            {
+                ((entityMasks[e].test(I) ? std::get<I>(pools).remove(e) : void()), ...);
+            }(std::index_sequence_for<Components...>{});
+            entityMasks[e] = {};
+            freedEntities.push_back(e);
+        }
+
+        template <typename T>
+        void addComponent(Entity e, T component)
+        {
+            emplaceComponent<T>(e, std::move(component));
+        }
+
+        template <typename T, typename... Args>
+        T& emplaceComponent(Entity e, Args&&... args)
+        {
+            T& component = getPool<T>().emplace(e, std::forward<Args>(args)...);
+            entityMasks[e].set(getTypeIndex<T>());
+            return component;
+        }
+
+        template <typename T>
+        bool hasComponent(Entity e) const
+        {
+            return entityMasks[e].test(getTypeIndex<T>());
+        }
+
+        // getComponent<T>() marks the component as changed, getComponent<const T>() only reads it
+        template <typename T>
+        T& getComponent(Entity e)
+        {
+            auto& pool = getPool<T>();
+            assert(pool.has(e));
+            if constexpr (std::is_const_v<T>)
+            {
+                return std::as_const(pool).get(e);
+            }
+            else
+            {
+                return pool.get(e);
+            }
+        }
+
+        template <typename T>
+        void removeComponent(Entity e)
+        {
+            getPool<T>().remove(e);
+            entityMasks[e].reset(getTypeIndex<T>());
+        }
+
+        template <typename... T>
+        View<T...> view()
+        {
+            return View<T...>(typename View<T...>::Pools(&getPool<T>()...));
+        }
+
+        template <typename... T, typename Fn>
+        void each(Fn&& fn)
+        {
+            view<T...>().each(std::forward<Fn>(fn));
+        }
+
+        template <typename... T>
+        std::vector<Entity> query()
+        {
+            std::vector<Entity> entities;
+            each<T...>([&entities](Entity e, T&...) { entities.push_back(e); });
+            return entities;
+        }
+    private:
+        std::tuple<ComponentPool<Components>...> pools;
+        // indexed by entity, bit i is set while the entity has the i-th of Components...
+        std::vector<ComponentMask> entityMasks;
+        std::vector<Entity> freedEntities;
+        Entity nextEntityID = 0;
+        uint32_t changeTick = 1;
     };
-}
\ No newline at end of file
+}
@@ -7,11 +7,18 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/mat4x4.hpp>
 
+#include "silk/TlsfAllocator.h"
+
 #include <vector>
 #include <array>
+#include <deque>
 #include <functional>
 #include <iostream>
 #include <format>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 
 #include <tiny_gltf.h>
 
@@ -103,12 +110,107 @@ namespace silk
 
     std::vector<uint16_t> getGLTFModelIndices(const tinygltf::Model& model);
 
+    // a VkDeviceMemory per call, contexts sub-allocate through DeviceMemoryAllocator instead
     VkResult allocateMemory(const VkPhysicalDevice physicalDevice, const VkDevice device, const VkMemoryRequirements& memoryRequirements, const VkMemoryPropertyFlags& propertyFlags, VkDeviceMemory& deviceMemory);
 
     VkResult createBuffer(const VkPhysicalDevice physicalDevice, const VkDevice device, const VkDeviceSize size, const VkBufferUsageFlags& usageFlags, const VkMemoryPropertyFlags& propertyFlags, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
 
     VkResult copyBuffer(const VkDevice device, const VkQueue graphicsQueue, const VkCommandPool commandPool, const VkBuffer srcBuffer, VkBuffer dstBuffer, const VkDeviceSize size);
 
+    // memory handed out by DeviceMemoryAllocator, either a range of a shared block or a VkDeviceMemory of its own
+    struct MemoryAllocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        // host visible memory stays mapped while allocated, this points at offset. nullptr otherwise
+        void* mapped = nullptr;
+        uint32_t memoryTypeIndex = UINT32_MAX;
+        // where the range came from, block is UINT32_MAX for dedicated allocations
+        uint32_t pool = UINT32_MAX;
+        uint32_t block = UINT32_MAX;
+        uint32_t node = TlsfAllocator::INVALID_NODE;
+    };
+
+    struct MemoryStats
+    {
+        uint32_t blockCount = 0;
+        uint32_t dedicatedCount = 0;
+        // live sub-allocations and dedicated allocations
+        uint32_t allocationCount = 0;
+        // bytes of every VkDeviceMemory, and the part of it handed out
+        VkDeviceSize reservedSize = 0;
+        VkDeviceSize usedSize = 0;
+        // largest free range of any block
+        VkDeviceSize largestFreeRange = 0;
+    };
+
+    // buffers and linearly tiled images versus optimally tiled ones, which must not share a bufferImageGranularity page
+    enum class ResourceTiling
+    {
+        Linear,
+        Optimal
+    };
+
+    // sub-allocates device memory out of large VkDeviceMemory blocks, a pool of blocks per memory type and tiling,
+    // ranges within a block come from a TlsfAllocator. resources above half a block, or those the driver wants
+    // dedicated, get a VkDeviceMemory of their own. host visible blocks are mapped once for their whole lifetime.
+    // owned by DeviceContext, thread safe
+    class DeviceMemoryAllocator
+    {
+    public:
+        // heaps smaller than 8 blocks use an eighth of the heap instead
+        static constexpr VkDeviceSize BLOCK_SIZE = VkDeviceSize(64) << 20;
+
+        DeviceMemoryAllocator(const VkPhysicalDevice physicalDevice, const VkDevice device);
+        ~DeviceMemoryAllocator();
+        DeviceMemoryAllocator(const DeviceMemoryAllocator&) = delete;
+        DeviceMemoryAllocator& operator=(const DeviceMemoryAllocator&) = delete;
+
+        // memory of the first type in memoryTypeBits with propertyFlags, falling back to later ones when it is full
+        MemoryAllocation allocate(const VkMemoryRequirements& memoryRequirements, const VkMemoryPropertyFlags propertyFlags, const ResourceTiling tiling);
+        void free(const MemoryAllocation& allocation);
+
+        // creates the resource, allocates its memory and binds it
+        MemoryAllocation createBuffer(const VkDeviceSize size, const VkBufferUsageFlags usageFlags, const VkMemoryPropertyFlags propertyFlags, VkBuffer& buffer);
+        MemoryAllocation createImage(const VkImageCreateInfo& imageCreateInfo, const VkMemoryPropertyFlags propertyFlags, VkImage& image);
+        void destroyBuffer(const VkBuffer buffer, const MemoryAllocation& allocation);
+        void destroyImage(const VkImage image, const MemoryAllocation& allocation);
+
+        MemoryStats getStats() const;
+        // stats per memory type to std::cout
+        void printStats() const;
+    private:
+        struct MemoryBlock
+        {
+            VkDeviceMemory memory;
+            std::byte* mapped;
+            TlsfAllocator allocator;
+        };
+
+        struct MemoryPool
+        {
+            VkDeviceSize blockSize;
+            // freed blocks leave a nullptr behind so indices in MemoryAllocation stay valid
+            std::vector<std::unique_ptr<MemoryBlock>> blocks;
+        };
+
+        VkDevice device;
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        VkDeviceSize bufferImageGranularity;
+        VkDeviceSize nonCoherentAtomSize;
+        // two per memory type, [memoryTypeIndex * 2 + optimal]
+        std::vector<MemoryPool> pools;
+        uint32_t dedicatedCount = 0;
+        VkDeviceSize dedicatedSize = 0;
+        mutable std::mutex mutex;
+
+        MemoryAllocation allocate(const VkMemoryRequirements& memoryRequirements, const VkMemoryPropertyFlags propertyFlags, const ResourceTiling tiling, const VkMemoryDedicatedAllocateInfo* dedicatedAllocateInfo);
+        VkResult allocateFromType(const uint32_t memoryTypeIndex, const VkMemoryRequirements& memoryRequirements, const ResourceTiling tiling, const VkMemoryDedicatedAllocateInfo* dedicatedAllocateInfo, MemoryAllocation& allocation);
+        VkResult allocateDeviceMemory(const uint32_t memoryTypeIndex, const VkDeviceSize size, const VkMemoryDedicatedAllocateInfo* dedicatedAllocateInfo, VkDeviceMemory& memory, std::byte*& mapped) const;
+        void freeDeviceMemory(const VkDeviceMemory memory, const std::byte* mapped) const;
+    };
+
     struct DeviceContextCreateInfo
     {
         const char* applicationName;
@@ -130,6 +232,7 @@ namespace silk
         uint32_t getGraphicsQueueFamilyIndex() const;
         VkQueue getPresentQueue() const;
         uint32_t getPresentQueueFamilyIndex() const;
+        DeviceMemoryAllocator& getMemoryAllocator() const;
     private:
         bool enableValidationLayers;
         VkInstance instance;
@@ -141,6 +244,7 @@ namespace silk
         uint32_t graphicsQueueFamilyIndex;
         VkQueue presentQueue;
         uint32_t presentQueueFamilyIndex;
+        std::unique_ptr<DeviceMemoryAllocator> memoryAllocator;
     };
 
     struct ImageViewContextCreateInfo
@@ -176,8 +280,9 @@ namespace silk
         VkExtent2D extent;
         VkSwapchainKHR swapchain;
         std::vector<ImageViewContext> swapchainImageViews;
+        DeviceMemoryAllocator& memoryAllocator;
         VkImage depthImage;
-        VkDeviceMemory depthImageMemory;
+        MemoryAllocation depthImageAllocation;
         VkImageView depthImageView;
         std::vector<VkFramebuffer> framebuffers;
         void create(GLFWwindow* window, const DeviceContext& deviceContext, VkRenderPass renderPass);
@@ -273,44 +378,117 @@ namespace silk
         VkPipeline pipeline;
     };
 
-    // NOTE: does not need to be rebuilt at runtime
-    template <typename T>
-    class DeviceLocalBufferContext
+    // copies data into device local buffers and images through a persistently mapped staging ring. copies are recorded
+    // into the current batch and submitted together by flush(), each batch signalling the next value of a timeline
+    // semaphore. ring space is reclaimed once its batch has completed, so uploads only wait when the ring is full and
+    // never for the queue to go idle. a batch ends in a barrier that makes its writes visible to everything submitted
+    // to the graphics queue after it, frames need no further synchronization. not thread safe, since flush() submits to
+    // the graphics queue
+    class UploadQueue
     {
     public:
-        DeviceLocalBufferContext(const DeviceContext& deviceContext, const VkCommandPool commandPool, const std::vector<T>& data, const VkBufferUsageFlags& usageFlags) : device(deviceContext.getDevice())
+        // uploads larger than stagingSize get a staging buffer of their own
+        UploadQueue(const DeviceContext& deviceContext, const VkDeviceSize stagingSize = VkDeviceSize(32) << 20);
+        ~UploadQueue();
+        UploadQueue(const UploadQueue&) = delete;
+        UploadQueue& operator=(const UploadQueue&) = delete;
+
+        // the uploads return the value the batch holding the copy signals
+        uint64_t uploadBuffer(const VkBuffer buffer, const VkDeviceSize offset, const void* data, const VkDeviceSize size);
+        // a whole single mip color image, UNDEFINED to finalLayout
+        uint64_t uploadImage(const VkImage image, const VkExtent3D& extent, const void* data, const VkDeviceSize size, const VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        // submits the current batch if it holds any copies, returns the value of the last submitted batch
+        uint64_t flush();
+        bool isComplete(const uint64_t value);
+        // blocks until value is signalled, flushing first if value belongs to the current batch
+        void wait(const uint64_t value);
+        // for work on other queues to wait on
+        VkSemaphore getSemaphore() const;
+        VkDeviceSize getStagingSize() const;
+    private:
+        struct StagingBuffer
         {
-            VkPhysicalDevice physicalDevice = deviceContext.getPhysicalDevice();
-            VkDeviceSize bufferSize = sizeof(T) * data.size();
+            VkBuffer buffer;
+            MemoryAllocation allocation;
+        };
 
-            VkBuffer stagingBuffer;
-            VkDeviceMemory stagingBufferMemory;
-            VK_CHECK(createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory));
+        struct StagingRange
+        {
+            VkBuffer buffer;
+            VkDeviceSize offset;
+        };
 
-            void *stagingData;
-            vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &stagingData);
-            memcpy(stagingData, data.data(), static_cast<size_t>(bufferSize));
-            vkUnmapMemory(device, stagingBufferMemory);
+        struct Batch
+        {
+            uint64_t value;
+            // ring position up to which the batch holds staging space
+            VkDeviceSize ringEnd;
+            VkCommandBuffer commandBuffer;
+            std::vector<StagingBuffer> oversized;
+        };
 
-            VK_CHECK(createBuffer(physicalDevice, device, bufferSize, usageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory));
-            VK_CHECK(copyBuffer(device, deviceContext.getGraphicsQueue(), commandPool, stagingBuffer, buffer, bufferSize));
+        VkDevice device;
+        DeviceMemoryAllocator& memoryAllocator;
+        VkQueue queue;
+        VkCommandPool commandPool;
+        VkSemaphore semaphore;
+        uint64_t submittedValue = 0;
+        uint64_t completedValue = 0;
+
+        // ring positions only grow, the staging offset of a position is position % stagingSize
+        VkDeviceSize stagingSize;
+        StagingBuffer ring;
+        VkDeviceSize head = 0;
+        VkDeviceSize tail = 0;
+
+        // current batch
+        VkCommandBuffer recording = VK_NULL_HANDLE;
+        std::vector<StagingBuffer> oversized;
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+
+        std::deque<Batch> inFlight;
+        std::vector<VkCommandBuffer> idleCommandBuffers;
+
+        StagingRange stage(const void* data, const VkDeviceSize size);
+        // offset of size free bytes in the ring, waiting for batches to complete while it is full
+        VkDeviceSize reserve(const VkDeviceSize size);
+        VkCommandBuffer getCommandBuffer();
+        // releases the staging space and command buffers of completed batches
+        void reclaim();
+    };
 
-            vkDestroyBuffer(device, stagingBuffer, nullptr);
-            vkFreeMemory(device, stagingBufferMemory, nullptr);
+    // NOTE: does not need to be rebuilt at runtime
+    template <typename T>
+    class DeviceLocalBufferContext
+    {
+    public:
+        // data is copied through uploadQueue, it is in place for graphics queue work submitted after uploadQueue.flush().
+        // uploadQueue must outlive the context
+        DeviceLocalBufferContext(const DeviceContext& deviceContext, UploadQueue& uploadQueue, const std::vector<T>& data, const VkBufferUsageFlags& usageFlags) : device(deviceContext.getDevice()), memoryAllocator(deviceContext.getMemoryAllocator()), uploadQueue(uploadQueue)
+        {
+            VkDeviceSize bufferSize = sizeof(T) * data.size();
+            allocation = memoryAllocator.createBuffer(bufferSize, usageFlags | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer);
+            uploadValue = uploadQueue.uploadBuffer(buffer, 0, data.data(), bufferSize);
             std::cout << "Create DeviceLocalBufferContext\n";
         }
         ~DeviceLocalBufferContext()
         {
+            // the copy may still sit in an unsubmitted batch, which vkDeviceWaitIdle does not cover
+            uploadQueue.wait(uploadValue);
             vkDeviceWaitIdle(device);
-            vkFreeMemory(device, bufferMemory, nullptr);
-            vkDestroyBuffer(device, buffer, nullptr);
+            memoryAllocator.destroyBuffer(buffer, allocation);
             std::cout << "Destroy DeviceLocalBufferContext\n";
         }
         VkBuffer getBuffer() const { return buffer; }
+        // UploadQueue value signalled once the data is in place
+        uint64_t getUploadValue() const { return uploadValue; }
     private:
         VkDevice device;
+        DeviceMemoryAllocator& memoryAllocator;
+        UploadQueue& uploadQueue;
         VkBuffer buffer;
-        VkDeviceMemory bufferMemory;
+        MemoryAllocation allocation;
+        uint64_t uploadValue;
     };
 
     // NOTE: does not need to be rebuilt at runtime
@@ -318,19 +496,17 @@ namespace silk
     class HostVisibleBufferContext
     {
     public:
-        HostVisibleBufferContext(const DeviceContext& deviceContext) : device(deviceContext.getDevice())
+        HostVisibleBufferContext(const DeviceContext& deviceContext) : device(deviceContext.getDevice()), memoryAllocator(deviceContext.getMemoryAllocator())
         {
             VkDeviceSize bufferSize = sizeof(T);
-            VK_CHECK(createBuffer(deviceContext.getPhysicalDevice(), device, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, bufferMemory));
-            VK_CHECK(vkMapMemory(device, bufferMemory, 0, bufferSize, 0, &bufferMapped));
+            allocation = memoryAllocator.createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer);
+            bufferMapped = allocation.mapped;
             std::cout << "Create HostVisibleBufferContext\n";
         }
         ~HostVisibleBufferContext()
         {
             vkDeviceWaitIdle(device);
-            vkUnmapMemory(device, bufferMemory);
-            vkDestroyBuffer(device, buffer, nullptr);
-            vkFreeMemory(device, bufferMemory, nullptr);
+            memoryAllocator.destroyBuffer(buffer, allocation);
             std::cout << "Destroy HostVisibleBufferContext\n";
         }
         VkDescriptorBufferInfo getVkDescriptorBufferInfos() const
@@ -344,8 +520,9 @@ namespace silk
         void memcpy(const T* data) const { std::memcpy(bufferMapped, data, sizeof(T)); }
     private:
         VkDevice device;
+        DeviceMemoryAllocator& memoryAllocator;
         VkBuffer buffer;
-        VkDeviceMemory bufferMemory;
+        MemoryAllocation allocation;
         void* bufferMapped;
     };
 
@@ -353,14 +530,19 @@ namespace silk
     class DeviceLocalImageContext
     {
     public:
-        DeviceLocalImageContext(const DeviceContext& deviceContext, const VkCommandPool commandPool, const tinygltf::Image& tinyImage);
+        // pixels are copied through uploadQueue, like DeviceLocalBufferContext. uploadQueue must outlive the context
+        DeviceLocalImageContext(const DeviceContext& deviceContext, UploadQueue& uploadQueue, const tinygltf::Image& tinyImage);
         ~DeviceLocalImageContext();
         VkSampler getSampler() const;
         VkImageView getImageView() const;
+        uint64_t getUploadValue() const;
     private:
         VkDevice device;
+        DeviceMemoryAllocator& memoryAllocator;
+        UploadQueue& uploadQueue;
         VkImage image;
-        VkDeviceMemory deviceMemory;
+        MemoryAllocation allocation;
+        uint64_t uploadValue;
         std::optional<ImageViewContext> imageViewContext;
         VkSampler sampler;
     };
@@ -372,11 +554,67 @@ namespace silk
     //     Camera(float fovy = 1.0f) : fovYAxis(fovy) {}
     // };
 
-    // struct InstanceData
-    // {
-    //     glm::mat4 model;
-    //     glm::vec4 tint;
-    //     static VkVertexInputBindingDescription getBindingDescription(uint32_t binding = 0);
-    //     static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptions(uint32_t binding = 0, uint32_t location = 0);
-    // };
+    class TransformInterpolator;
+
+    // per-instance vertex input: a model matrix over four consecutive locations and a tint. BINDING and LOCATION
+    // stay clear of per-vertex inputs, shaders declare layout(location = 8) in mat4 and layout(location = 12) in vec4
+    struct InstanceData
+    {
+        static constexpr uint32_t BINDING = 1;
+        static constexpr uint32_t LOCATION = 8;
+
+        glm::mat4 model;
+        glm::vec4 tint;
+
+        static VkVertexInputBindingDescription getBindingDescription();
+        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+    };
+
+    // InstanceData for every frame in flight in one persistently mapped buffer. each frame writes only its own region,
+    // so filling it never waits on frames the GPU is still reading. a frame that needs more room moves everyone to a
+    // buffer at least twice as large, the old buffer is destroyed once every other frame has been mapped again,
+    // so growing never idles the device
+    class InstanceBufferContext
+    {
+    public:
+        InstanceBufferContext(const DeviceContext& deviceContext, uint32_t framesInFlight, uint32_t initialCapacity = 1024);
+        ~InstanceBufferContext();
+        InstanceBufferContext(const InstanceBufferContext&) = delete;
+        InstanceBufferContext& operator=(const InstanceBufferContext&) = delete;
+        // room for count instances in frame's region. call it once per frame, after waiting on that frame's fence
+        InstanceData* map(uint32_t frame, uint32_t count);
+        // one instance per entity of the last TransformInterpolator::interpolate(), returns the instance count
+        uint32_t update(uint32_t frame, const TransformInterpolator& interpolator, const glm::vec4& tint = glm::vec4(1.0f));
+        // one instance per matrix, such as TransformHierarchy::getWorldMatrices(), returns the instance count
+        uint32_t update(uint32_t frame, std::span<const glm::mat4> matrices, const glm::vec4& tint = glm::vec4(1.0f));
+        // binds frame's region at InstanceData::BINDING
+        void bind(VkCommandBuffer commandBuffer, uint32_t frame) const;
+        uint32_t getInstanceCount(uint32_t frame) const;
+        // instances per frame
+        uint32_t getCapacity() const;
+    private:
+        struct Allocation
+        {
+            VkBuffer buffer;
+            MemoryAllocation memory;
+            InstanceData* mapped;
+        };
+
+        struct RetiredAllocation
+        {
+            Allocation allocation;
+            // bit i is set while frame i may still have submitted work reading this buffer
+            uint32_t pendingFrames;
+        };
+
+        VkDevice device;
+        DeviceMemoryAllocator& memoryAllocator;
+        uint32_t framesInFlight;
+        uint32_t capacity;
+        Allocation current;
+        std::vector<uint32_t> instanceCounts;
+        std::vector<RetiredAllocation> retired;
+        Allocation allocate(uint32_t newCapacity) const;
+        void release(const Allocation& allocation) const;
+    };
 }
\ No newline at end of file
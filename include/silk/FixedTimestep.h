@@ -0,0 +1,95 @@
+#pragma once
+
+#include "silk/ECS.h"
+#include "silk/TransformBatch.h"
+
+#include <chrono>
+#include <span>
+#include <vector>
+
+namespace silk
+{
+    // decouples simulation from rendering: elapsed time is accumulated and spent in ticks of a fixed duration,
+    // whatever is left over becomes the interpolation factor for the frame that is rendered afterwards
+    class FixedTimestep
+    {
+    public:
+        explicit FixedTimestep(double tickRate = 60.0, uint32_t maxTicksPerFrame = 8);
+
+        // adds elapsed seconds and returns how many ticks are due. at most maxTicksPerFrame ticks run per frame, the
+        // time beyond that is dropped so a slow frame cannot snowball into ever longer catch-up frames
+        uint32_t advance(double elapsed);
+        // advance() with the wall time since the previous call, the first call counts from construction
+        uint32_t advance();
+
+        // runs tick(getTickDuration()) once per due tick, then render(getAlpha())
+        template <typename Tick, typename Render>
+        void frame(Tick&& tick, Render&& render)
+        {
+            for (uint32_t ticks = advance(); ticks > 0; ticks--)
+            {
+                tick(getTickDuration());
+            }
+            render(getAlpha());
+        }
+
+        float getTickDuration() const { return static_cast<float>(tickDuration); }
+        // fraction of a tick accumulated but not simulated yet, in [0, 1)
+        float getAlpha() const { return static_cast<float>(accumulator / tickDuration); }
+        uint64_t getTickCount() const { return tickCount; }
+    private:
+        double tickDuration;
+        uint32_t maxTicksPerFrame;
+        double accumulator = 0.0;
+        uint64_t tickCount = 0;
+        std::chrono::steady_clock::time_point lastTime;
+    };
+
+    // keeps the Transform every entity had when the current tick started, so frames rendered between ticks can blend
+    // it with the current one. call beginTick() before each simulation tick, then interpolate(getAlpha()) and
+    // writeMatrices() when rendering. the scene must outlive this
+    class TransformInterpolator
+    {
+    public:
+        explicit TransformInterpolator(Scene& scene);
+        ~TransformInterpolator();
+        TransformInterpolator(const TransformInterpolator&) = delete;
+        TransformInterpolator& operator=(const TransformInterpolator&) = delete;
+
+        // records the Transforms changed since the last call as the state the coming tick starts from
+        void beginTick();
+        // makes e render at its current Transform until the next tick, so teleports are not smeared across a frame
+        void snap(Entity e);
+
+        // blends previous and current Transforms of every entity, position and scale linearly, rotation along the
+        // shorter arc
+        void interpolate(float alpha);
+        // entities of the last interpolate(), in the order writeMatrices() writes them
+        std::span<const Entity> getEntities() const { return entities; }
+        // matrices of the last interpolate(), written like computeMatrices()
+        void writeMatrices(std::byte* out, size_t stride = sizeof(glm::mat4), SimdLevel level = getSimdLevel()) const;
+    private:
+        struct State
+        {
+            glm::vec2 position;
+            float rotation;
+            glm::vec2 scale;
+        };
+
+        Scene& scene;
+        std::vector<Connection> connections;
+        uint32_t lastTick = 0;
+
+        // previous states, dense and indexed through entityToState
+        SparseIndex entityToState;
+        std::vector<State> states;
+        std::vector<Entity> stateOwners;
+
+        // output of interpolate(), structure of arrays for computeMatrices()
+        std::vector<Entity> entities;
+        std::vector<float> positionX, positionY, rotation, scaleX, scaleY;
+
+        void record(Entity e);
+        void erase(Entity e);
+    };
+}
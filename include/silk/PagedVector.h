@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <span>
+#include <bit>
+#include <new>
+#include <memory_resource>
+#include <utility>
+#include <cassert>
+
+namespace silk
+{
+    // vector-like sequence stored in fixed-size pages from a memory resource. elements never move when it grows,
+    // pages are kept when it shrinks and only returned to the resource on destruction
+    template <typename T>
+    class PagedVector
+    {
+    public:
+        static constexpr size_t PAGE_BYTES = 16384;
+        // a power of two, so indexing is a shift and a mask
+        static constexpr size_t PAGE_SIZE = std::bit_floor(std::max<size_t>(1, PAGE_BYTES / sizeof(T)));
+        static constexpr size_t PAGE_SHIFT = std::countr_zero(PAGE_SIZE);
+
+        explicit PagedVector(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : resource(resource) {}
+
+        ~PagedVector()
+        {
+            clear();
+            for (T* page : pages)
+            {
+                resource->deallocate(page, PAGE_SIZE * sizeof(T), alignof(T));
+            }
+        }
+
+        PagedVector(const PagedVector&) = delete;
+        PagedVector& operator=(const PagedVector&) = delete;
+
+        T& operator[](size_t index) { return pages[index >> PAGE_SHIFT][index & (PAGE_SIZE - 1)]; }
+        const T& operator[](size_t index) const { return pages[index >> PAGE_SHIFT][index & (PAGE_SIZE - 1)]; }
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        size_t capacity() const { return pages.size() * PAGE_SIZE; }
+
+        T& back() { return (*this)[count - 1]; }
+
+        template <typename... Args>
+        T& emplace_back(Args&&... args)
+        {
+            if (count == capacity())
+            {
+                addPage();
+            }
+
+            T* element = new (&(*this)[count]) T(std::forward<Args>(args)...);
+            count++;
+            return *element;
+        }
+
+        void push_back(const T& value) { emplace_back(value); }
+        void push_back(T&& value) { emplace_back(std::move(value)); }
+
+        void pop_back()
+        {
+            assert(count > 0);
+            count--;
+            (*this)[count].~T();
+        }
+
+        void reserve(size_t newCapacity)
+        {
+            pages.reserve((newCapacity + PAGE_SIZE - 1) >> PAGE_SHIFT);
+            while (capacity() < newCapacity)
+            {
+                addPage();
+            }
+        }
+
+        void resize(size_t newSize)
+        {
+            reserve(newSize);
+            while (count < newSize)
+            {
+                emplace_back();
+            }
+            while (count > newSize)
+            {
+                pop_back();
+            }
+        }
+
+        void clear()
+        {
+            while (count > 0)
+            {
+                pop_back();
+            }
+        }
+
+        // calls fn(std::span<T>) for each contiguous run of elements, front to back
+        template <typename Fn>
+        void forEachBlock(Fn&& fn)
+        {
+            for (size_t first = 0; first < count; first += PAGE_SIZE)
+            {
+                fn(std::span<T>(pages[first >> PAGE_SHIFT], std::min(PAGE_SIZE, count - first)));
+            }
+        }
+
+        template <typename Fn>
+        void forEachBlock(Fn&& fn) const
+        {
+            for (size_t first = 0; first < count; first += PAGE_SIZE)
+            {
+                fn(std::span<const T>(pages[first >> PAGE_SHIFT], std::min(PAGE_SIZE, count - first)));
+            }
+        }
+    private:
+        std::pmr::memory_resource* resource;
+        std::vector<T*> pages;
+        size_t count = 0;
+
+        void addPage()
+        {
+            pages.push_back(static_cast<T*>(resource->allocate(PAGE_SIZE * sizeof(T), alignof(T))));
+        }
+    };
+}
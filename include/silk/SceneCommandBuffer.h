@@ -0,0 +1,169 @@
+#pragma once
+
+#include "silk/ECS.h"
+
+namespace silk
+{
+    // records structural changes and applies them to a Scene at a sync point. each worker of the ThreadPool, plus one
+    // thread outside of it, records into its own queue, so recording takes no locks.
+    // entities returned by createEntity() are placeholders that may only be passed back to this buffer until playback().
+    // playback() applies every creation, then all component additions grouped by component type, then all component
+    // removals grouped by component type, then every deletion
+    class SceneCommandBuffer
+    {
+    public:
+        static constexpr Entity PENDING_ENTITY_BIT = 1u << 31;
+        static constexpr uint32_t SLOT_SHIFT = 23;
+        static constexpr uint32_t MAX_PENDING_PER_SLOT = 1u << SLOT_SHIFT;
+
+        explicit SceneCommandBuffer(const ThreadPool& threadPool);
+        SceneCommandBuffer(const SceneCommandBuffer&) = delete;
+        SceneCommandBuffer& operator=(const SceneCommandBuffer&) = delete;
+
+        Entity createEntity();
+
+        template <typename T>
+        void addComponent(Entity e, T component)
+        {
+            getCommands<T>().adds.emplace_back(e, std::move(component));
+        }
+
+        template <typename T>
+        void removeComponent(Entity e)
+        {
+            getCommands<T>().removes.push_back(e);
+        }
+
+        void deleteEntity(Entity e);
+        bool empty() const;
+        void playback(Scene& scene);
+        // drops every recorded command without applying it
+        void clear();
+    private:
+        struct BaseComponentCommands
+        {
+            virtual ~BaseComponentCommands() = default;
+            // both apply the commands of this component type recorded by every thread
+            virtual void playbackAdds(Scene& scene, SceneCommandBuffer& buffer, uint32_t typeID) = 0;
+            virtual void playbackRemoves(Scene& scene, SceneCommandBuffer& buffer, uint32_t typeID) = 0;
+            virtual bool empty() const = 0;
+            virtual void clear() = 0;
+        };
+
+        template <typename T>
+        struct ComponentCommands : BaseComponentCommands
+        {
+            std::vector<std::pair<Entity, T>> adds;
+            std::vector<Entity> removes;
+
+            void playbackAdds(Scene& scene, SceneCommandBuffer& buffer, uint32_t typeID) override
+            {
+                std::vector<std::pair<Entity, T>*> allAdds;
+                for (ThreadQueue& queue : buffer.queues)
+                {
+                    if (auto* commands = queue.template getCommands<T>(typeID))
+                    {
+                        for (auto& add : commands->adds)
+                        {
+                            add.first = buffer.resolve(add.first);
+                            allAdds.push_back(&add);
+                        }
+                    }
+                }
+
+                // entity order walks the sparse index pages front to back
+                std::sort(allAdds.begin(), allAdds.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+                if (scene.getStorageMode() == StorageMode::Sparse)
+                {
+                    ComponentPool<T>& pool = scene.getComponentPool<T>();
+                    pool.reserve(pool.components.size() + allAdds.size());
+                }
+
+                for (auto* add : allAdds)
+                {
+                    scene.emplaceComponent<T>(add->first, std::move(add->second));
+                }
+            }
+
+            void playbackRemoves(Scene& scene, SceneCommandBuffer& buffer, uint32_t typeID) override
+            {
+                std::vector<Entity> allRemoves;
+                for (ThreadQueue& queue : buffer.queues)
+                {
+                    if (auto* commands = queue.template getCommands<T>(typeID))
+                    {
+                        for (Entity e : commands->removes)
+                        {
+                            allRemoves.push_back(buffer.resolve(e));
+                        }
+                    }
+                }
+
+                // removing in descending dense order only ever swaps in survivors, so the indices of pending removals
+                // never change, and removals already at the back of the pool are plain pops
+                if (scene.getStorageMode() == StorageMode::Sparse)
+                {
+                    const ComponentPool<T>& pool = scene.getComponentPool<T>();
+                    std::sort(allRemoves.begin(), allRemoves.end(), [&pool](Entity a, Entity b)
+                    {
+                        return pool.entityToComponentIndex.get(a) > pool.entityToComponentIndex.get(b);
+                    });
+                }
+
+                for (Entity e : allRemoves)
+                {
+                    scene.removeComponent<T>(e);
+                }
+            }
+
+            bool empty() const override { return adds.empty() && removes.empty(); }
+
+            void clear() override
+            {
+                adds.clear();
+                removes.clear();
+            }
+        };
+
+        // cache line aligned so threads recording at the same time do not share lines
+        struct alignas(64) ThreadQueue
+        {
+            uint32_t createdCount = 0;
+            std::vector<Entity> created;
+            std::vector<Entity> deletedEntities;
+            std::vector<std::unique_ptr<BaseComponentCommands>> componentCommands;
+
+            template <typename T>
+            ComponentCommands<T>* getCommands(uint32_t typeID)
+            {
+                return typeID < componentCommands.size() ? static_cast<ComponentCommands<T>*>(componentCommands[typeID].get()) : nullptr;
+            }
+        };
+
+        const ThreadPool& threadPool;
+        std::vector<ThreadQueue> queues;
+
+        // the calling worker's queue, threads outside of the pool share the last one
+        ThreadQueue& getQueue();
+        Entity resolve(Entity e) const;
+
+        template <typename T>
+        ComponentCommands<T>& getCommands()
+        {
+            ThreadQueue& queue = getQueue();
+            const uint32_t typeID = getComponentTypeID<T>();
+            if (typeID >= queue.componentCommands.size())
+            {
+                queue.componentCommands.resize(typeID + 1);
+            }
+
+            if (!queue.componentCommands[typeID])
+            {
+                queue.componentCommands[typeID] = std::make_unique<ComponentCommands<T>>();
+            }
+
+            return static_cast<ComponentCommands<T>&>(*queue.componentCommands[typeID]);
+        }
+    };
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "silk/ECS.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+#include <tuple>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace silk
+{
+    // read-only mapping of a whole file, unmapped on destruction
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string& filename);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        std::span<const std::byte> getData() const { return { data, size }; }
+    private:
+        const std::byte* data = nullptr;
+        size_t size = 0;
+#ifdef _WIN32
+        void* fileHandle = nullptr;
+        void* mappingHandle = nullptr;
+#endif
+    };
+
+    // binary scene format: Header, the free list, then for each component type in the order passed to
+    // save()/load() a PoolHeader followed by the raw owners and components arrays of its ComponentPool.
+    // type IDs are not stable across runs, so the same component types must be listed in the same order on load
+    class SceneSnapshot
+    {
+    public:
+        static constexpr char MAGIC[8] = {'S', 'I', 'L', 'K', 'S', 'C', 'N', '\0'};
+        static constexpr uint32_t VERSION = 1;
+
+        struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t poolCount;
+            uint32_t nextEntityID;
+            uint32_t freedCount;
+        };
+
+        struct PoolHeader
+        {
+            uint32_t componentSize;
+            uint32_t count;
+        };
+
+        template <typename... T>
+        static void save(Scene& scene, const std::string& filename)
+        {
+            static_assert((std::is_trivially_copyable_v<T> && ...), "only trivially copyable components can be snapshotted");
+            assert(scene.getStorageMode() == StorageMode::Sparse);
+
+            std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                throw std::runtime_error("Error: failed to open " + filename + "!");
+            }
+
+            Header header{};
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = VERSION;
+            header.poolCount = sizeof...(T);
+            header.nextEntityID = scene.nextEntityID;
+            header.freedCount = static_cast<uint32_t>(scene.freedEntities.size());
+            write(file, std::as_bytes(std::span(&header, 1)));
+            write(file, std::as_bytes(std::span(scene.freedEntities)));
+
+            (savePool(file, scene.getComponentPool<T>()), ...);
+
+            if (!file)
+            {
+                throw std::runtime_error("Error: failed to write " + filename + "!");
+            }
+        }
+
+        // scene must be an empty sparse scene without groups, every loaded component counts as added at the current tick.
+        // everything is loaded into temporaries first, so a corrupt file throws and leaves scene untouched
+        template <typename... T>
+        static void load(Scene& scene, const std::string& filename)
+        {
+            static_assert((std::is_trivially_copyable_v<T> && ...), "only trivially copyable components can be snapshotted");
+            assert(scene.getStorageMode() == StorageMode::Sparse);
+            assert(scene.nextEntityID == 0 && scene.groups.empty());
+
+            const MappedFile file(filename);
+            std::span<const std::byte> data = file.getData();
+
+            Header header;
+            read(data, std::as_writable_bytes(std::span(&header, 1)), filename);
+            if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.poolCount != sizeof...(T))
+            {
+                throw std::runtime_error("Error: " + filename + " is not a compatible scene snapshot!");
+            }
+
+            checkAvailable(data, header.freedCount, sizeof(Entity), filename);
+            std::vector<Entity> freedEntities(header.freedCount);
+            read(data, std::as_writable_bytes(std::span(freedEntities)), filename);
+            for (Entity e : freedEntities)
+            {
+                if (e >= header.nextEntityID)
+                {
+                    throw std::runtime_error("Error: scene snapshot " + filename + " contains an invalid entity!");
+                }
+            }
+
+            // masks only grow as far as the highest entity owning a component, like Scene::getEntityMask()
+            std::vector<ComponentMask> entityMasks;
+            // a braced list loads the pools front to back
+            std::tuple<std::unique_ptr<ComponentPool<T>>...> pools{ loadPool<T>(scene, data, header.nextEntityID, entityMasks, filename)... };
+
+            // sized before anything is swapped in, nothing after this point throws
+            const uint32_t maxTypeID = std::max({ getComponentTypeID<T>()... });
+            if (scene.componentPools.size() <= maxTypeID)
+            {
+                scene.componentPools.resize(maxTypeID + 1);
+            }
+            ((scene.componentPools[getComponentTypeID<T>()] = std::move(std::get<std::unique_ptr<ComponentPool<T>>>(pools))), ...);
+            scene.nextEntityID = header.nextEntityID;
+            scene.freedEntities = std::move(freedEntities);
+            scene.entityMasks = std::move(entityMasks);
+        }
+    private:
+        static void write(std::ofstream& file, std::span<const std::byte> bytes)
+        {
+            file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        }
+
+        // copies the next dst.size() bytes of data into dst and advances data past them
+        static void read(std::span<const std::byte>& data, std::span<std::byte> dst, const std::string& filename)
+        {
+            if (data.size() < dst.size())
+            {
+                throw std::runtime_error("Error: scene snapshot " + filename + " is truncated!");
+            }
+
+            if (!dst.empty())
+            {
+                std::memcpy(dst.data(), data.data(), dst.size());
+            }
+            data = data.subspan(dst.size());
+        }
+
+        // throws unless data holds count elements of elementSize bytes, so a corrupt count never sizes an allocation
+        static void checkAvailable(std::span<const std::byte> data, uint64_t count, size_t elementSize, const std::string& filename)
+        {
+            if (count > data.size() / elementSize)
+            {
+                throw std::runtime_error("Error: scene snapshot " + filename + " is truncated!");
+            }
+        }
+
+        template <typename T>
+        static void savePool(std::ofstream& file, const ComponentPool<T>& pool)
+        {
+            const PoolHeader header{ sizeof(T), static_cast<uint32_t>(pool.components.size()) };
+            write(file, std::as_bytes(std::span(&header, 1)));
+            write(file, std::as_bytes(std::span(pool.owners)));
+            if constexpr (ComponentTraits<T>::PAGED)
+            {
+                pool.components.forEachBlock([&](std::span<const T> block) { write(file, std::as_bytes(block)); });
+            }
+            else
+            {
+                write(file, std::as_bytes(std::span(pool.components)));
+            }
+        }
+
+        template <typename T>
+        static std::unique_ptr<ComponentPool<T>> loadPool(Scene& scene, std::span<const std::byte>& data, Entity nextEntityID, std::vector<ComponentMask>& entityMasks, const std::string& filename)
+        {
+            PoolHeader header;
+            read(data, std::as_writable_bytes(std::span(&header, 1)), filename);
+            if (header.componentSize != sizeof(T))
+            {
+                throw std::runtime_error("Error: scene snapshot " + filename + " does not match the component layout!");
+            }
+            checkAvailable(data, header.count, sizeof(Entity) + sizeof(T), filename);
+
+            // pages of paged pools come from the scene's memory, where they stay if the pool is swapped in
+            auto pool = std::make_unique<ComponentPool<T>>(scene.componentMemory);
+            pool->changeTick = &scene.changeTick;
+
+            // both arrays are copied in one block each, only the sparse index and masks are rebuilt per entity
+            pool->owners.resize(header.count);
+            pool->components.resize(header.count);
+            read(data, std::as_writable_bytes(std::span(pool->owners)), filename);
+            if constexpr (ComponentTraits<T>::PAGED)
+            {
+                pool->components.forEachBlock([&](std::span<T> block) { read(data, std::as_writable_bytes(block), filename); });
+            }
+            else
+            {
+                read(data, std::as_writable_bytes(std::span(pool->components)), filename);
+            }
+            pool->addedTicks.assign(header.count, pool->getChangeTick());
+            pool->changedTicks.assign(header.count, pool->getChangeTick());
+
+            const uint32_t typeID = getComponentTypeID<T>();
+            for (uint32_t i = 0; i < header.count; i++)
+            {
+                const Entity e = pool->owners[i];
+                if (e >= nextEntityID || pool->has(e))
+                {
+                    throw std::runtime_error("Error: scene snapshot " + filename + " contains an invalid entity!");
+                }
+                pool->entityToComponentIndex.set(e, i);
+                if (e >= entityMasks.size())
+                {
+                    entityMasks.resize(static_cast<size_t>(e) + 1);
+                }
+                entityMasks[e].set(typeID);
+            }
+            return pool;
+        }
+    };
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "silk/ECS.h"
+#include "silk/SceneCommandBuffer.h"
+#include "silk/ThreadPool.h"
+
+#include <string>
+#include <atomic>
+
+namespace silk
+{
+    // component access declarations for Scheduler::addSystem, a const T is treated as T
+    template <typename... T>
+    struct Read
+    {
+        static std::vector<uint32_t> getTypeIDs() { return { getComponentTypeID<std::remove_const_t<T>>()... }; }
+        static void registerComponents(Scene& scene) { scene.registerComponents<std::remove_const_t<T>...>(); }
+    };
+
+    template <typename... T>
+    struct Write
+    {
+        static std::vector<uint32_t> getTypeIDs() { return { getComponentTypeID<std::remove_const_t<T>>()... }; }
+        static void registerComponents(Scene& scene) { scene.registerComponents<std::remove_const_t<T>...>(); }
+    };
+
+    // runs systems once per run() call. a system depends on every earlier registered system it conflicts with
+    // (one writes a component the other reads or writes), systems without a path between them run concurrently.
+    // systems may read/write components in place, structural changes are recorded into getCommandBuffer() and played
+    // back once every system has finished
+    class Scheduler
+    {
+    public:
+        explicit Scheduler(ThreadPool& threadPool);
+
+        template <typename Reads, typename Writes = Write<>>
+        void addSystem(std::string name, std::function<void(Scene&)> fn)
+        {
+            System system{};
+            system.name = std::move(name);
+            system.reads = Reads::getTypeIDs();
+            system.writes = Writes::getTypeIDs();
+            system.fn = std::move(fn);
+            system.registerComponents = [](Scene& scene)
+            {
+                Reads::registerComponents(scene);
+                Writes::registerComponents(scene);
+            };
+            systems.push_back(std::move(system));
+            graphDirty = true;
+        }
+
+        void run(Scene& scene);
+        size_t getSystemCount() const;
+        SceneCommandBuffer& getCommandBuffer();
+        std::vector<std::string> getDependencies(const std::string& name);
+    private:
+        struct System
+        {
+            std::string name;
+            std::vector<uint32_t> reads;
+            std::vector<uint32_t> writes;
+            std::function<void(Scene&)> fn;
+            std::function<void(Scene&)> registerComponents;
+            std::vector<size_t> dependents;
+            uint32_t dependencyCount;
+        };
+
+        ThreadPool& threadPool;
+        SceneCommandBuffer commandBuffer;
+        std::vector<System> systems;
+        std::unique_ptr<std::atomic<uint32_t>[]> remainingDependencies;
+        bool graphDirty = false;
+        void buildGraph();
+    };
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "silk/ECS.h"
+#include "silk/Transform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace silk
+{
+    // loose uniform hash grid over the 2D bounds of every entity with a Transform (getPosition() +- |getScale()| / 2).
+    // an entity lives only in the cell containing its center, queries widen their range by the largest half extent
+    // seen so far. Transform additions and removals are applied immediately through scene signals, movement is picked
+    // up by update() from the Transform change ticks, so the scene must outlive this
+    class SpatialGrid
+    {
+    public:
+        SpatialGrid(Scene& scene, float cellSize);
+        ~SpatialGrid();
+        SpatialGrid(const SpatialGrid&) = delete;
+        SpatialGrid& operator=(const SpatialGrid&) = delete;
+
+        // moves every entity whose Transform changed since the last update() to its new cell
+        void update();
+
+        // fn(Entity) for every entity whose bounds overlap [min, max]
+        template <typename Fn>
+        void queryAABB(glm::vec2 min, glm::vec2 max, Fn&& fn) const
+        {
+            forEachCandidate(min - maxHalfExtent, max + maxHalfExtent, [&](const Entry& entry)
+            {
+                if (entry.center.x + entry.halfExtent.x >= min.x && entry.center.x - entry.halfExtent.x <= max.x &&
+                    entry.center.y + entry.halfExtent.y >= min.y && entry.center.y - entry.halfExtent.y <= max.y)
+                {
+                    fn(entry.entity);
+                }
+            });
+        }
+
+        // fn(Entity) for every entity whose bounds are within radius of center
+        template <typename Fn>
+        void queryRadius(glm::vec2 center, float radius, Fn&& fn) const
+        {
+            const glm::vec2 extent(radius, radius);
+            forEachCandidate(center - extent - maxHalfExtent, center + extent + maxHalfExtent, [&](const Entry& entry)
+            {
+                if (getDistanceSquared(entry, center) <= radius * radius)
+                {
+                    fn(entry.entity);
+                }
+            });
+        }
+
+        std::vector<Entity> queryAABB(glm::vec2 min, glm::vec2 max) const;
+        std::vector<Entity> queryRadius(glm::vec2 center, float radius) const;
+        // entity whose bounds are closest to point, searching cell rings outwards until no closer one is possible
+        std::optional<Entity> queryNearest(glm::vec2 point, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+        size_t size() const { return count; }
+        float getCellSize() const { return cellSize; }
+    private:
+        struct Entry
+        {
+            Entity entity;
+            glm::vec2 center;
+            glm::vec2 halfExtent;
+        };
+
+        struct Location
+        {
+            uint32_t cell = UINT32_MAX;
+            uint32_t slot = UINT32_MAX;
+        };
+
+        struct Cell
+        {
+            uint64_t key;
+            std::vector<Entry> entries;
+        };
+
+        Scene& scene;
+        float cellSize;
+        float inverseCellSize;
+        std::vector<Connection> connections;
+        uint32_t lastTick = 0;
+        size_t count = 0;
+        // grows only, so it stays conservative when large entities move away or are removed
+        glm::vec2 maxHalfExtent{0.0f, 0.0f};
+        // bounding range of every cell ever used, limits nearest searches
+        int32_t minCellX = INT32_MAX, minCellY = INT32_MAX, maxCellX = INT32_MIN, maxCellY = INT32_MIN;
+        // cells are never removed, so locations can refer to them by index and moves within a cell skip the hash lookup
+        std::unordered_map<uint64_t, uint32_t> cellLookup;
+        std::vector<Cell> cells;
+        // indexed by entity
+        std::vector<Location> locations;
+
+        void insert(Entity e);
+        void erase(Entity e);
+        void move(Entity e);
+        Entry makeEntry(Entity e) const;
+
+        // clamped so infinite or far away query bounds cannot overflow the cell coordinate
+        int32_t getCellCoordinate(float value) const
+        {
+            constexpr float LIMIT = static_cast<float>(1 << 30);
+            return static_cast<int32_t>(std::clamp(std::floor(value * inverseCellSize), -LIMIT, LIMIT));
+        }
+
+        static uint64_t getCellKey(int32_t x, int32_t y)
+        {
+            return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+        }
+
+        static float getDistanceSquared(const Entry& entry, glm::vec2 point)
+        {
+            const float dx = std::max(std::fabs(point.x - entry.center.x) - entry.halfExtent.x, 0.0f);
+            const float dy = std::max(std::fabs(point.y - entry.center.y) - entry.halfExtent.y, 0.0f);
+            return dx * dx + dy * dy;
+        }
+
+        // fn(const Entry&) for every entry stored in a cell overlapping [min, max]
+        template <typename Fn>
+        void forEachCandidate(glm::vec2 min, glm::vec2 max, Fn&& fn) const
+        {
+            const int64_t x0 = getCellCoordinate(min.x), x1 = getCellCoordinate(max.x);
+            const int64_t y0 = getCellCoordinate(min.y), y1 = getCellCoordinate(max.y);
+
+            // a range covering more cells than exist is cheaper to answer by visiting every cell
+            if ((x1 - x0 + 1) * (y1 - y0 + 1) > static_cast<int64_t>(cells.size()))
+            {
+                for (const Cell& cell : cells)
+                {
+                    for (const Entry& entry : cell.entries)
+                    {
+                        fn(entry);
+                    }
+                }
+                return;
+            }
+
+            for (int64_t y = y0; y <= y1; y++)
+            {
+                for (int64_t x = x0; x <= x1; x++)
+                {
+                    auto it = cellLookup.find(getCellKey(static_cast<int32_t>(x), static_cast<int32_t>(y)));
+                    if (it == cellLookup.end())
+                    {
+                        continue;
+                    }
+
+                    for (const Entry& entry : cells[it->second].entries)
+                    {
+                        fn(entry);
+                    }
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+namespace silk
+{
+    // work-stealing pool: every worker owns a deque, pops its newest task and steals the oldest task of others when idle
+    class ThreadPool
+    {
+    public:
+        static constexpr uint32_t NOT_A_WORKER = UINT32_MAX;
+
+        explicit ThreadPool(uint32_t workerCount = std::max(1u, std::thread::hardware_concurrency()));
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        void submit(std::function<void()> task);
+        // runs one queued task on the calling thread, returns false if there was none
+        bool runPendingTask();
+        uint32_t getWorkerCount() const;
+        // index of the calling thread among this pool's workers or NOT_A_WORKER
+        uint32_t getCurrentWorkerIndex() const;
+        // process-wide pool with one worker per hardware thread, created on first use
+        static ThreadPool& getDefault();
+
+        // splits [0, count) into ranges of grainSize and calls fn(begin, end) for each, the calling thread helps until all are done
+        template <typename Fn>
+        void parallelFor(size_t count, size_t grainSize, Fn&& fn)
+        {
+            grainSize = std::max<size_t>(grainSize, 1);
+            const size_t rangeCount = (count + grainSize - 1) / grainSize;
+            if (rangeCount <= 1 || workers.empty())
+            {
+                if (count > 0)
+                {
+                    fn(size_t(0), count);
+                }
+                return;
+            }
+
+            std::atomic<size_t> remaining = rangeCount;
+            std::mutex errorMutex;
+            std::exception_ptr error;
+            for (size_t begin = 0; begin < count; begin += grainSize)
+            {
+                const size_t end = std::min(begin + grainSize, count);
+                submit([&, begin, end]
+                {
+                    try
+                    {
+                        fn(begin, end);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(errorMutex);
+                        if (!error)
+                        {
+                            error = std::current_exception();
+                        }
+                    }
+                    remaining.fetch_sub(1, std::memory_order_release);
+                });
+            }
+
+            while (remaining.load(std::memory_order_acquire) > 0)
+            {
+                if (!runPendingTask())
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    private:
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+        std::atomic<uint32_t> nextQueue = 0;
+        std::atomic<uint32_t> pendingTasks = 0;
+        std::mutex sleepMutex;
+        std::condition_variable condition;
+        bool stopping = false;
+        void workerLoop(uint32_t workerIndex);
+        bool popTask(uint32_t queueIndex, std::function<void()>& task);
+        bool stealTask(uint32_t thiefIndex, std::function<void()>& task);
+    };
+}
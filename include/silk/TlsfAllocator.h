@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace silk
+{
+    // two-level segregated fit allocator over the range [0, size). it only hands out offsets, the memory behind them
+    // belongs to the caller. free ranges are bucketed by power of two and SL_COUNT linear steps within it, two bitmaps
+    // find the first bucket whose ranges all fit. free() is O(1), so is allocate() whenever such a bucket exists.
+    // otherwise allocate() falls back to scanning the ranges of the smaller buckets that might still fit, which is
+    // linear in their number. freed ranges merge with free neighbours right away
+    class TlsfAllocator
+    {
+    public:
+        static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+
+        struct Allocation
+        {
+            uint64_t offset;
+            uint64_t size;
+            // hand back to free()
+            uint32_t node;
+        };
+
+        explicit TlsfAllocator(uint64_t size);
+
+        // alignment must be a power of two
+        std::optional<Allocation> allocate(uint64_t size, uint64_t alignment = 1);
+        void free(uint32_t node);
+
+        uint64_t getSize() const { return size; }
+        uint64_t getUsedSize() const { return usedSize; }
+        uint32_t getAllocationCount() const { return allocationCount; }
+        bool empty() const { return allocationCount == 0; }
+        // size of the largest free range
+        uint64_t getLargestFreeRange() const;
+    private:
+        static constexpr uint32_t SL_BITS = 5;
+        static constexpr uint32_t SL_COUNT = 1u << SL_BITS;
+        static constexpr uint32_t FL_COUNT = 64 - SL_BITS + 1;
+
+        // a free or allocated range, linked to its physical neighbours and, while free, to its bucket
+        struct Node
+        {
+            uint64_t offset;
+            uint64_t size;
+            uint32_t prevPhysical = INVALID_NODE;
+            uint32_t nextPhysical = INVALID_NODE;
+            uint32_t prevFree = INVALID_NODE;
+            uint32_t nextFree = INVALID_NODE;
+            bool free = false;
+        };
+
+        uint64_t size;
+        uint64_t usedSize = 0;
+        uint32_t allocationCount = 0;
+
+        std::vector<Node> nodes;
+        std::vector<uint32_t> unusedNodes;
+
+        uint64_t flBitmap = 0;
+        std::array<uint32_t, FL_COUNT> slBitmaps{};
+        std::array<uint32_t, FL_COUNT * SL_COUNT> freeHeads;
+
+        // bucket holding ranges of exactly size
+        static uint32_t getBucket(uint64_t size);
+        // first non-empty bucket at or above bucket, INVALID_NODE if there is none
+        uint32_t findBucket(uint32_t bucket) const;
+        uint32_t createNode(uint64_t offset, uint64_t size);
+        void insertFree(uint32_t node);
+        void removeFree(uint32_t node);
+        // cuts node after its first size bytes, the rest becomes a new node in no bucket
+        uint32_t split(uint32_t node, uint64_t size);
+        // appends next, node's physical successor, to node
+        void merge(uint32_t node, uint32_t next);
+    };
+}
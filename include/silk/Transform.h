@@ -1,26 +1,70 @@
 #pragma once
 #include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
 
 namespace silk
 {
+    // 2D affine transform stored as the three columns of a 2x3 matrix, a third of a glm::mat4.
+    // expand it with toMat4() only where a 4x4 matrix is required, such as GPU uploads
+    struct Affine2D
+    {
+        glm::vec2 x{1.0f, 0.0f};
+        glm::vec2 y{0.0f, 1.0f};
+        glm::vec2 translation{0.0f, 0.0f};
+
+        glm::vec2 transformPoint(glm::vec2 point) const { return x * point.x + y * point.y + translation; }
+
+        glm::mat4 toMat4() const
+        {
+            return glm::mat4(
+                x.x, x.y, 0.0f, 0.0f,
+                y.x, y.y, 0.0f, 0.0f,
+                0.0f, 0.0f, 1.0f, 0.0f,
+                translation.x, translation.y, 0.0f, 1.0f
+            );
+        }
+
+        // applies b first, then a
+        friend Affine2D operator*(const Affine2D& a, const Affine2D& b)
+        {
+            return { a.x * b.x.x + a.y * b.x.y, a.x * b.y.x + a.y * b.y.y, a.transformPoint(b.translation) };
+        }
+    };
+
+    // the matrix is rebuilt lazily by the first non-const getter after a setter, so setting position, rotation and scale
+    // in a row costs one evaluation. const getters never write the cache, a dirty Transform is evaluated on the fly, so
+    // any number of threads may read the same Transform while none writes it
     class Transform
     {
     public:
-        glm::vec2 getPosition() const;
-        float getRotation() const;
-        glm::vec2 getScale() const;
-        glm::mat4 getMatrix() const;
-        void setPosition(float x, float y);
-        void setPosition(const glm::vec2& position);
-        void setRotation(float rotation);
-        void setScale(float x, float y);
-        void setScale(const glm::vec2& scale);
-        Transform(glm::vec2 position = glm::vec2(), float rotation = 0.0f, glm::vec2 scale = glm::vec2(1,1)) : pos(position), rot(rotation), s(scale) { updateMat(); }
+        glm::vec2 getPosition() const { return pos; }
+        float getRotation() const { return rot; }
+        glm::vec2 getScale() const { return s; }
+        Affine2D getAffine() const { return dirty ? computeAffine() : affine; }
+        // refreshes the cache, needs exclusive access like the setters
+        const Affine2D& getAffine()
+        {
+            if (dirty)
+            {
+                affine = computeAffine();
+                dirty = false;
+            }
+            return affine;
+        }
+        glm::mat4 getMatrix() const { return getAffine().toMat4(); }
+        glm::mat4 getMatrix() { return getAffine().toMat4(); }
+        void setPosition(float x, float y) { pos = glm::vec2(x, y); dirty = true; }
+        void setPosition(const glm::vec2& position) { setPosition(position.x, position.y); }
+        void setRotation(float rotation) { rot = rotation; dirty = true; }
+        void setScale(float x, float y) { s = glm::vec2(x, y); dirty = true; }
+        void setScale(const glm::vec2& scale) { setScale(scale.x, scale.y); }
+        Transform(glm::vec2 position = glm::vec2(), float rotation = 0.0f, glm::vec2 scale = glm::vec2(1,1)) : pos(position), rot(rotation), s(scale) {}
     private:
         glm::vec2 pos;
         float rot;
         glm::vec2 s;
-        glm::mat4 mat;
-        void updateMat();
+        Affine2D affine;
+        bool dirty = true;
+        Affine2D computeAffine() const;
     };
-}
\ No newline at end of file
+}
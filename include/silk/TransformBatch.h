@@ -0,0 +1,65 @@
+#pragma once
+
+#include "silk/Transform.h"
+#include "silk/ECS.h"
+
+#include <cassert>
+#include <cstddef>
+#include <span>
+
+namespace silk
+{
+    enum class SimdLevel
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // widest instruction set the running CPU supports, detected on first use
+    SimdLevel getSimdLevel();
+
+    // structure of arrays mirror of count Transforms
+    struct TransformArrays
+    {
+        const float* positionX;
+        const float* positionY;
+        const float* rotation;
+        const float* scaleX;
+        const float* scaleY;
+        size_t count;
+    };
+
+    // writes the matrix of transform i, as Transform::getMatrix() would return it, to out + i * stride. out needs no
+    // particular alignment, so it can point straight into a mapped instance buffer whose elements start with a mat4.
+    // SIMD levels evaluate sin and cos with a polynomial, accurate to a few ulp for rotations within +-8192 radians
+    void computeMatrices(const TransformArrays& transforms, std::byte* out, size_t stride = sizeof(glm::mat4), SimdLevel level = getSimdLevel());
+    void computeMatrices(std::span<const Transform> transforms, std::byte* out, size_t stride = sizeof(glm::mat4), SimdLevel level = getSimdLevel());
+
+    inline void computeMatrices(std::span<const Transform> transforms, std::span<glm::mat4> out, SimdLevel level = getSimdLevel())
+    {
+        assert(out.size() >= transforms.size());
+        computeMatrices(transforms, reinterpret_cast<std::byte*>(out.data()), sizeof(glm::mat4), level);
+    }
+
+    // matrices of a pool's Transforms in dense order, matrix i belongs to pool.owners[i]. paged pools are walked one
+    // page at a time
+    inline void computeMatrices(const ComponentPool<Transform>& pool, std::byte* out, size_t stride = sizeof(glm::mat4), SimdLevel level = getSimdLevel())
+    {
+        size_t first = 0;
+        pool.forEachBlock([&](std::span<const Transform> block)
+        {
+            computeMatrices(block, out + first * stride, stride, level);
+            first += block.size();
+        });
+    }
+
+    // every Transform of a sparse scene, returns the entities the matrices belong to in output order. the span stays
+    // valid until a Transform is added or removed
+    inline std::span<const Entity> computeMatrices(Scene& scene, std::byte* out, size_t stride = sizeof(glm::mat4), SimdLevel level = getSimdLevel())
+    {
+        const ComponentPool<Transform>& pool = scene.getComponentStorage<Transform>();
+        computeMatrices(pool, out, stride, level);
+        return pool.owners;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "silk/ECS.h"
+#include "silk/ThreadPool.h"
+#include "silk/Transform.h"
+
+#include <atomic>
+#include <span>
+#include <vector>
+
+namespace silk
+{
+    // attaches an entity's Transform to the Transform of another entity. entities whose parent has no Transform are
+    // roots. delete children together with their parent, a dangling parent ID could be reused by a new entity
+    struct Parent
+    {
+        Entity entity;
+    };
+
+    // computes world matrices for every entity with a Transform. nodes are kept in one array sorted by depth, so a
+    // parent is always computed before its children in a single front to back pass. only subtrees below a changed
+    // Transform are recomputed, levels wider than the grain size are split across the thread pool.
+    // Parent and Transform additions and removals are observed through scene signals, so the scene must outlive this
+    // Parent components that form a cycle make update() throw std::runtime_error and leave the last world matrices
+    // in place, the rebuild is retried on the next update()
+    class TransformHierarchy
+    {
+    public:
+        static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+        explicit TransformHierarchy(Scene& scene);
+        ~TransformHierarchy();
+        TransformHierarchy(const TransformHierarchy&) = delete;
+        TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+        // recomputes the world matrices of changed subtrees, nullptr selects ThreadPool::getDefault()
+        void update(ThreadPool* threadPool = nullptr, size_t grainSize = 4096);
+
+        // world matrix as of the last update()
+        const glm::mat4& getWorldMatrix(Entity e) const;
+        // entities and their world matrices in depth order, parallel arrays
+        std::span<const Entity> getEntities() const { return entities; }
+        std::span<const glm::mat4> getWorldMatrices() const { return worldMatrices; }
+        uint32_t getDepthCount() const { return static_cast<uint32_t>(levelStarts.size()) - 1; }
+        // number of world matrices recomputed by the last update()
+        size_t getRecomputedCount() const { return recomputedCount; }
+    private:
+        Scene& scene;
+        std::vector<Connection> connections;
+        bool structureDirty = true;
+        uint32_t lastTick = 0;
+
+        // all parallel, indexed by node
+        std::vector<Entity> entities;
+        std::vector<uint32_t> parentNodes;
+        std::vector<glm::mat4> worldMatrices;
+        std::vector<uint8_t> dirty;
+        // nodes of depth d are [levelStarts[d], levelStarts[d + 1])
+        std::vector<uint32_t> levelStarts{0};
+        SparseIndex entityToNode;
+        size_t recomputedCount = 0;
+
+        void rebuild();
+        void markChanged();
+        void computeRange(size_t begin, size_t end, std::atomic<size_t>& recomputed);
+    };
+}
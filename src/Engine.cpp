@@ -1,8 +1,13 @@
 #include "silk/Engine.h"
+#include "silk/FixedTimestep.h"
 #include "silk/Transform.h"
 
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cassert>
 #include <chrono>
+#include <cstddef>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <set>
@@ -274,6 +279,407 @@ namespace silk
         return VK_SUCCESS;
     }
 
+    DeviceMemoryAllocator::DeviceMemoryAllocator(const VkPhysicalDevice physicalDevice, const VkDevice device) : device(device)
+    {
+        VkPhysicalDeviceMemoryProperties2 memoryProperties2{};
+        memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memoryProperties2);
+        memoryProperties = memoryProperties2.memoryProperties;
+
+        VkPhysicalDeviceProperties physicalDeviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+        bufferImageGranularity = physicalDeviceProperties.limits.bufferImageGranularity;
+        nonCoherentAtomSize = physicalDeviceProperties.limits.nonCoherentAtomSize;
+
+        pools.resize(memoryProperties.memoryTypeCount * 2);
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+        {
+            const VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size;
+            const VkDeviceSize blockSize = heapSize < 8 * BLOCK_SIZE ? heapSize / 8 : BLOCK_SIZE;
+            pools[i * 2].blockSize = blockSize;
+            pools[i * 2 + 1].blockSize = blockSize;
+        }
+
+        std::cout << "Create DeviceMemoryAllocator\n";
+    }
+
+    DeviceMemoryAllocator::~DeviceMemoryAllocator()
+    {
+        const MemoryStats stats = getStats();
+        if (stats.allocationCount > 0)
+        {
+            std::cout << "Warning: DeviceMemoryAllocator destroyed with " << stats.allocationCount << " live allocations\n";
+        }
+
+        for (const MemoryPool& pool : pools)
+        {
+            for (const auto& block : pool.blocks)
+            {
+                if (block)
+                {
+                    freeDeviceMemory(block->memory, block->mapped);
+                }
+            }
+        }
+
+        std::cout << "Destroy DeviceMemoryAllocator\n";
+    }
+
+    MemoryAllocation DeviceMemoryAllocator::allocate(const VkMemoryRequirements& memoryRequirements, const VkMemoryPropertyFlags propertyFlags, const ResourceTiling tiling)
+    {
+        return allocate(memoryRequirements, propertyFlags, tiling, nullptr);
+    }
+
+    void DeviceMemoryAllocator::free(const MemoryAllocation& allocation)
+    {
+        if (allocation.memory == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        std::lock_guard lock(mutex);
+        if (allocation.block == UINT32_MAX)
+        {
+            freeDeviceMemory(allocation.memory, static_cast<const std::byte*>(allocation.mapped));
+            dedicatedCount--;
+            dedicatedSize -= allocation.size;
+            return;
+        }
+
+        MemoryPool& pool = pools[allocation.pool];
+        MemoryBlock& block = *pool.blocks[allocation.block];
+        block.allocator.free(allocation.node);
+
+        // one empty block per pool is kept, so resources that come and go do not allocate device memory every time
+        if (block.allocator.empty())
+        {
+            const bool otherEmpty = std::any_of(pool.blocks.begin(), pool.blocks.end(), [&](const auto& other) { return other && other.get() != &block && other->allocator.empty(); });
+            if (otherEmpty)
+            {
+                freeDeviceMemory(block.memory, block.mapped);
+                pool.blocks[allocation.block].reset();
+            }
+        }
+    }
+
+    MemoryAllocation DeviceMemoryAllocator::createBuffer(const VkDeviceSize size, const VkBufferUsageFlags usageFlags, const VkMemoryPropertyFlags propertyFlags, VkBuffer& buffer)
+    {
+        VkBufferCreateInfo bufferCreateInfo{};
+        bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferCreateInfo.size = size;
+        bufferCreateInfo.usage = usageFlags;
+        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VK_CHECK(vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer));
+
+        VkBufferMemoryRequirementsInfo2 memoryRequirementsInfo{};
+        memoryRequirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+        memoryRequirementsInfo.buffer = buffer;
+
+        VkMemoryDedicatedRequirements dedicatedRequirements{};
+        dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+        VkMemoryRequirements2 memoryRequirements2{};
+        memoryRequirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        memoryRequirements2.pNext = &dedicatedRequirements;
+
+        vkGetBufferMemoryRequirements2(device, &memoryRequirementsInfo, &memoryRequirements2);
+
+        VkMemoryDedicatedAllocateInfo dedicatedAllocateInfo{};
+        dedicatedAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+        dedicatedAllocateInfo.buffer = buffer;
+
+        const bool dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+        MemoryAllocation allocation;
+        try
+        {
+            allocation = allocate(memoryRequirements2.memoryRequirements, propertyFlags, ResourceTiling::Linear, dedicated ? &dedicatedAllocateInfo : nullptr);
+        }
+        catch (...)
+        {
+            vkDestroyBuffer(device, buffer, nullptr);
+            throw;
+        }
+
+        try
+        {
+            VK_CHECK(vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset));
+        }
+        catch (...)
+        {
+            destroyBuffer(buffer, allocation);
+            throw;
+        }
+        return allocation;
+    }
+
+    MemoryAllocation DeviceMemoryAllocator::createImage(const VkImageCreateInfo& imageCreateInfo, const VkMemoryPropertyFlags propertyFlags, VkImage& image)
+    {
+        VK_CHECK(vkCreateImage(device, &imageCreateInfo, nullptr, &image));
+
+        VkImageMemoryRequirementsInfo2 memoryRequirementsInfo{};
+        memoryRequirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+        memoryRequirementsInfo.image = image;
+
+        VkMemoryDedicatedRequirements dedicatedRequirements{};
+        dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+        VkMemoryRequirements2 memoryRequirements2{};
+        memoryRequirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        memoryRequirements2.pNext = &dedicatedRequirements;
+
+        vkGetImageMemoryRequirements2(device, &memoryRequirementsInfo, &memoryRequirements2);
+
+        VkMemoryDedicatedAllocateInfo dedicatedAllocateInfo{};
+        dedicatedAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+        dedicatedAllocateInfo.image = image;
+
+        const bool dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+        const ResourceTiling tiling = imageCreateInfo.tiling == VK_IMAGE_TILING_LINEAR ? ResourceTiling::Linear : ResourceTiling::Optimal;
+        MemoryAllocation allocation;
+        try
+        {
+            allocation = allocate(memoryRequirements2.memoryRequirements, propertyFlags, tiling, dedicated ? &dedicatedAllocateInfo : nullptr);
+        }
+        catch (...)
+        {
+            vkDestroyImage(device, image, nullptr);
+            throw;
+        }
+
+        try
+        {
+            VK_CHECK(vkBindImageMemory(device, image, allocation.memory, allocation.offset));
+        }
+        catch (...)
+        {
+            destroyImage(image, allocation);
+            throw;
+        }
+        return allocation;
+    }
+
+    void DeviceMemoryAllocator::destroyBuffer(const VkBuffer buffer, const MemoryAllocation& allocation)
+    {
+        vkDestroyBuffer(device, buffer, nullptr);
+        free(allocation);
+    }
+
+    void DeviceMemoryAllocator::destroyImage(const VkImage image, const MemoryAllocation& allocation)
+    {
+        vkDestroyImage(device, image, nullptr);
+        free(allocation);
+    }
+
+    MemoryStats DeviceMemoryAllocator::getStats() const
+    {
+        std::lock_guard lock(mutex);
+        MemoryStats stats{};
+        stats.dedicatedCount = dedicatedCount;
+        stats.allocationCount = dedicatedCount;
+        stats.reservedSize = dedicatedSize;
+        stats.usedSize = dedicatedSize;
+        for (const MemoryPool& pool : pools)
+        {
+            for (const auto& block : pool.blocks)
+            {
+                if (block)
+                {
+                    stats.blockCount++;
+                    stats.allocationCount += block->allocator.getAllocationCount();
+                    stats.reservedSize += block->allocator.getSize();
+                    stats.usedSize += block->allocator.getUsedSize();
+                    stats.largestFreeRange = std::max(stats.largestFreeRange, block->allocator.getLargestFreeRange());
+                }
+            }
+        }
+        return stats;
+    }
+
+    void DeviceMemoryAllocator::printStats() const
+    {
+        std::lock_guard lock(mutex);
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+        {
+            uint32_t blockCount = 0;
+            uint32_t allocationCount = 0;
+            VkDeviceSize reservedSize = 0;
+            VkDeviceSize usedSize = 0;
+            for (const MemoryPool* pool : { &pools[i * 2], &pools[i * 2 + 1] })
+            {
+                for (const auto& block : pool->blocks)
+                {
+                    if (block)
+                    {
+                        blockCount++;
+                        allocationCount += block->allocator.getAllocationCount();
+                        reservedSize += block->allocator.getSize();
+                        usedSize += block->allocator.getUsedSize();
+                    }
+                }
+            }
+
+            if (blockCount > 0)
+            {
+                std::cout << std::format("Memory type {} (heap {}): {} blocks, {} allocations, {} of {} KiB used\n", i, memoryProperties.memoryTypes[i].heapIndex, blockCount, allocationCount, usedSize >> 10, reservedSize >> 10);
+            }
+        }
+        std::cout << std::format("Dedicated: {} allocations, {} KiB\n", dedicatedCount, dedicatedSize >> 10);
+    }
+
+    MemoryAllocation DeviceMemoryAllocator::allocate(const VkMemoryRequirements& memoryRequirements, const VkMemoryPropertyFlags propertyFlags, const ResourceTiling tiling, const VkMemoryDedicatedAllocateInfo* dedicatedAllocateInfo)
+    {
+        std::lock_guard lock(mutex);
+        VkResult lastResult = VK_SUCCESS;
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+        {
+            if ((memoryRequirements.memoryTypeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & propertyFlags) == propertyFlags)
+            {
+                MemoryAllocation allocation{};
+                lastResult = allocateFromType(i, memoryRequirements, tiling, dedicatedAllocateInfo, allocation);
+                if (lastResult == VK_SUCCESS)
+                {
+                    return allocation;
+                }
+            }
+        }
+
+        if (lastResult == VK_SUCCESS)
+        {
+            throw std::runtime_error("ERROR: failed to find suitable memory type!");
+        }
+        throw std::runtime_error(std::format("ERROR: failed to allocate device memory! ({})", toString(lastResult)));
+    }
+
+    VkResult DeviceMemoryAllocator::allocateFromType(const uint32_t memoryTypeIndex, const VkMemoryRequirements& memoryRequirements, const ResourceTiling tiling, const VkMemoryDedicatedAllocateInfo* dedicatedAllocateInfo, MemoryAllocation& allocation)
+    {
+        // flushing a non coherent range then never touches a neighbour's atoms
+        VkDeviceSize alignment = memoryRequirements.alignment;
+        const VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+        if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+        {
+            alignment = std::max(alignment, nonCoherentAtomSize);
+        }
+
+        // linear and optimal resources only share blocks when they cannot share a bufferImageGranularity page anyway
+        const uint32_t poolIndex = memoryTypeIndex * 2 + (tiling == ResourceTiling::Optimal && bufferImageGranularity > 1 ? 1 : 0);
+        MemoryPool& pool = pools[poolIndex];
+
+        allocation.memoryTypeIndex = memoryTypeIndex;
+        allocation.pool = poolIndex;
+        allocation.size = memoryRequirements.size;
+
+        if (dedicatedAllocateInfo != nullptr || memoryRequirements.size > pool.blockSize / 2)
+        {
+            std::byte* mapped;
+            const VkResult result = allocateDeviceMemory(memoryTypeIndex, memoryRequirements.size, dedicatedAllocateInfo, allocation.memory, mapped);
+            if (result != VK_SUCCESS)
+            {
+                return result;
+            }
+
+            allocation.mapped = mapped;
+            dedicatedCount++;
+            dedicatedSize += memoryRequirements.size;
+            return VK_SUCCESS;
+        }
+
+        const auto fill = [&](uint32_t blockIndex, const TlsfAllocator::Allocation& range)
+        {
+            const MemoryBlock& block = *pool.blocks[blockIndex];
+            allocation.memory = block.memory;
+            allocation.offset = range.offset;
+            allocation.mapped = block.mapped != nullptr ? block.mapped + range.offset : nullptr;
+            allocation.block = blockIndex;
+            allocation.node = range.node;
+        };
+
+        for (uint32_t i = 0; i < pool.blocks.size(); i++)
+        {
+            if (pool.blocks[i])
+            {
+                if (const auto range = pool.blocks[i]->allocator.allocate(memoryRequirements.size, alignment))
+                {
+                    fill(i, *range);
+                    return VK_SUCCESS;
+                }
+            }
+        }
+
+        // a new block, smaller ones while the heap cannot fit a full one
+        VkDeviceSize blockSize = pool.blockSize;
+        VkDeviceMemory memory;
+        std::byte* mapped;
+        for (;;)
+        {
+            const VkResult result = allocateDeviceMemory(memoryTypeIndex, blockSize, nullptr, memory, mapped);
+            if (result == VK_SUCCESS)
+            {
+                break;
+            }
+            if (result != VK_ERROR_OUT_OF_DEVICE_MEMORY || blockSize / 2 < memoryRequirements.size)
+            {
+                return result;
+            }
+            blockSize /= 2;
+        }
+
+        const auto hole = std::find(pool.blocks.begin(), pool.blocks.end(), nullptr);
+        const uint32_t blockIndex = static_cast<uint32_t>(hole - pool.blocks.begin());
+        auto block = std::make_unique<MemoryBlock>(MemoryBlock{ memory, mapped, TlsfAllocator(blockSize) });
+        if (hole == pool.blocks.end())
+        {
+            pool.blocks.push_back(std::move(block));
+        }
+        else
+        {
+            *hole = std::move(block);
+        }
+
+        // offset 0 of a fresh block satisfies any alignment
+        fill(blockIndex, *pool.blocks[blockIndex]->allocator.allocate(memoryRequirements.size, alignment));
+        return VK_SUCCESS;
+    }
+
+    VkResult DeviceMemoryAllocator::allocateDeviceMemory(const uint32_t memoryTypeIndex, const VkDeviceSize size, const VkMemoryDedicatedAllocateInfo* dedicatedAllocateInfo, VkDeviceMemory& memory, std::byte*& mapped) const
+    {
+        VkMemoryAllocateInfo memoryAllocateInfo{};
+        memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        memoryAllocateInfo.pNext = dedicatedAllocateInfo;
+        memoryAllocateInfo.allocationSize = size;
+        memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+        VkResult result = vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &memory);
+        if (result != VK_SUCCESS)
+        {
+            return result;
+        }
+
+        mapped = nullptr;
+        if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        {
+            void* data;
+            result = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data);
+            if (result != VK_SUCCESS)
+            {
+                vkFreeMemory(device, memory, nullptr);
+                return result;
+            }
+            mapped = static_cast<std::byte*>(data);
+        }
+
+        return VK_SUCCESS;
+    }
+
+    void DeviceMemoryAllocator::freeDeviceMemory(const VkDeviceMemory memory, const std::byte* mapped) const
+    {
+        if (mapped != nullptr)
+        {
+            vkUnmapMemory(device, memory);
+        }
+        vkFreeMemory(device, memory, nullptr);
+    }
+
     VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, [[maybe_unused]] VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, [[maybe_unused]] void* pUserData)
     {
         if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
@@ -424,6 +830,15 @@ namespace silk
                     requiredExtensions.erase(extension.extensionName);
                 }
 
+                // timeline semaphore support, UploadQueue signals through one
+                VkPhysicalDeviceVulkan12Features vulkan12Features{};
+                vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+                VkPhysicalDeviceFeatures2 features2{};
+                features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+                features2.pNext = &vulkan12Features;
+                vkGetPhysicalDeviceFeatures2(physDev, &features2);
+
                 // swapchain support
                 uint32_t surfaceFormatCount;
                 vkGetPhysicalDeviceSurfaceFormatsKHR(physDev, surface, &surfaceFormatCount, nullptr);
@@ -434,6 +849,7 @@ namespace silk
                 if (graphicsIndex.has_value()
                     && presentIndex.has_value()
                     && requiredExtensions.empty()
+                    && vulkan12Features.timelineSemaphore
                     && surfaceFormatCount != 0
                     && presentModeCount != 0)
                 {
@@ -471,8 +887,13 @@ namespace silk
 
             VkPhysicalDeviceFeatures deviceFeatures{};
 
+            VkPhysicalDeviceVulkan12Features vulkan12Features{};
+            vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+            vulkan12Features.timelineSemaphore = VK_TRUE;
+
             VkDeviceCreateInfo deviceCreateInfo{};
             deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+            deviceCreateInfo.pNext = &vulkan12Features;
             deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
             deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
             deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
@@ -488,6 +909,8 @@ namespace silk
             vkGetDeviceQueue(device, presentQueueFamilyIndex, 0, &presentQueue);
         }
 
+        memoryAllocator = std::make_unique<DeviceMemoryAllocator>(physicalDevice, device);
+
         std::cout << "Create DeviceContext\n";
     }
 
@@ -495,6 +918,9 @@ namespace silk
     {
         vkDeviceWaitIdle(device);
 
+        // every context allocating from it is gone by now
+        memoryAllocator.reset();
+
         // destroy VkDevice
         vkDestroyDevice(device, nullptr);
 
@@ -531,6 +957,8 @@ namespace silk
 
     uint32_t DeviceContext::getPresentQueueFamilyIndex() const { return presentQueueFamilyIndex; }
 
+    DeviceMemoryAllocator& DeviceContext::getMemoryAllocator() const { return *memoryAllocator; }
+
     ImageViewContext::ImageViewContext(const VkDevice device, const ImageViewContextCreateInfo& createInfo) : device(device)
     {
         VkImageViewCreateInfo imageViewCreateInfo{};
@@ -560,7 +988,7 @@ namespace silk
 
     VkImageView ImageViewContext::getImageView() const { return imageView; }
 
-    SwapchainContext::SwapchainContext(GLFWwindow* window, const DeviceContext& deviceContext, VkRenderPass renderPass) : device(deviceContext.getDevice()) { create(window, deviceContext, renderPass); }
+    SwapchainContext::SwapchainContext(GLFWwindow* window, const DeviceContext& deviceContext, VkRenderPass renderPass) : device(deviceContext.getDevice()), memoryAllocator(deviceContext.getMemoryAllocator()) { create(window, deviceContext, renderPass); }
 
     SwapchainContext::~SwapchainContext() { destroy(); }
 
@@ -709,15 +1137,7 @@ namespace silk
             depthImageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
             depthImageCreateInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
 
-            VK_CHECK(vkCreateImage(device, &depthImageCreateInfo, nullptr, &depthImage));
-
-            VkMemoryRequirements memoryRequirements;
-            vkGetImageMemoryRequirements(device, depthImage, &memoryRequirements);
-
-            VkMemoryPropertyFlags propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-            VK_CHECK(allocateMemory(physicalDevice, device, memoryRequirements, propertyFlags, depthImageMemory));
-
-            VK_CHECK(vkBindImageMemory(device, depthImage, depthImageMemory, 0));
+            depthImageAllocation = memoryAllocator.createImage(depthImageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage);
 
             // image views
             VkImageViewCreateInfo depthImageViewCreateInfo{};
@@ -771,8 +1191,7 @@ namespace silk
 
         // destroy depth image
         vkDestroyImageView(device, depthImageView, nullptr);
-        vkFreeMemory(device, depthImageMemory, nullptr);
-        vkDestroyImage(device, depthImage, nullptr);
+        memoryAllocator.destroyImage(depthImage, depthImageAllocation);
 
         // destroy VkSwapchainKHR
         vkDestroySwapchainKHR(device, swapchain, nullptr);
@@ -942,117 +1361,294 @@ namespace silk
         vkCmdPipelineBarrier(commandBuffer, info.srcStageMask, info.dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
     }
 
-    DeviceLocalImageContext::DeviceLocalImageContext(const DeviceContext& deviceContext, const VkCommandPool commandPool, const tinygltf::Image& tinyImage) : device(deviceContext.getDevice())
+    UploadQueue::UploadQueue(const DeviceContext& deviceContext, const VkDeviceSize stagingSize)
+        : device(deviceContext.getDevice()), memoryAllocator(deviceContext.getMemoryAllocator()), queue(deviceContext.getGraphicsQueue()), stagingSize(stagingSize)
     {
-        const VkPhysicalDevice physicalDevice = deviceContext.getPhysicalDevice();
+        assert(stagingSize > 0);
 
-        // === create VkImage ===
-        VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
-        VkImageCreateInfo imageCreateInfo{};
-        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-        imageCreateInfo.extent.width = tinyImage.width;
-        imageCreateInfo.extent.height = tinyImage.height;
-        imageCreateInfo.extent.depth = 1;
-        imageCreateInfo.mipLevels = 1;
-        imageCreateInfo.arrayLayers = 1;
-        imageCreateInfo.format = format;
-        imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        VkCommandPoolCreateInfo commandPoolCreateInfo{};
+        commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        commandPoolCreateInfo.queueFamilyIndex = deviceContext.getGraphicsQueueFamilyIndex();
+        VK_CHECK(vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool));
 
-        VK_CHECK(vkCreateImage(device, &imageCreateInfo, nullptr, &image));
+        VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{};
+        semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        semaphoreTypeCreateInfo.initialValue = 0;
 
-        VkMemoryRequirements memoryRequirements;
-        vkGetImageMemoryRequirements(device, image, &memoryRequirements);
+        VkSemaphoreCreateInfo semaphoreCreateInfo{};
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+        VK_CHECK(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &semaphore));
 
-        VkMemoryPropertyFlagBits propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-        VK_CHECK(allocateMemory(physicalDevice, device, memoryRequirements, propertyFlags, deviceMemory));
+        ring.allocation = memoryAllocator.createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ring.buffer);
 
-        VK_CHECK(vkBindImageMemory(device, image, deviceMemory, 0));
+        std::cout << "Create UploadQueue\n";
+    }
 
-        // create staging buffer
-        VkDeviceSize imageSize = tinyImage.bits / 8 * tinyImage.component * tinyImage.width * tinyImage.height;
-        
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        VK_CHECK(createBuffer(physicalDevice, device, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory));
+    UploadQueue::~UploadQueue()
+    {
+        flush();
+        vkDeviceWaitIdle(device);
+        reclaim();
 
-        void *stagingData;
-        vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &stagingData);
-        memcpy(stagingData, tinyImage.image.data(), static_cast<size_t>(imageSize));
-        vkUnmapMemory(device, stagingBufferMemory);
+        memoryAllocator.destroyBuffer(ring.buffer, ring.allocation);
+        vkDestroySemaphore(device, semaphore, nullptr);
+        vkDestroyCommandPool(device, commandPool, nullptr);
+        std::cout << "Destroy UploadQueue\n";
+    }
 
-        // record command buffer
-        VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
-        commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        commandBufferAllocateInfo.commandPool = commandPool;
-        commandBufferAllocateInfo.commandBufferCount = 1;
+    uint64_t UploadQueue::uploadBuffer(const VkBuffer buffer, const VkDeviceSize offset, const void* data, const VkDeviceSize size)
+    {
+        assert(size > 0);
+        const StagingRange staging = stage(data, size);
 
-        VkCommandBuffer commandBuffer;
-        VK_CHECK(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &commandBuffer));
+        VkBufferCopy bufferCopy{};
+        bufferCopy.srcOffset = staging.offset;
+        bufferCopy.dstOffset = offset;
+        bufferCopy.size = size;
+        vkCmdCopyBuffer(getCommandBuffer(), staging.buffer, buffer, 1, &bufferCopy);
 
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        return submittedValue + 1;
+    }
 
-        VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
-            // TODO https://docs.vulkan.org/guide/latest/deprecated.html#top_of_pipe_replacement
-            // transition: UNDEFINED -> TRANSFER_DST_OPTIMALA
-            {
-                TransitionImageMemoryBarrierInfo transitionImageMemoryBarrierInfo{
-                    0,
-                    VK_ACCESS_TRANSFER_WRITE_BIT,
-                    VK_IMAGE_LAYOUT_UNDEFINED,
-                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                    VK_PIPELINE_STAGE_TRANSFER_BIT
-                };
-                transitionImageMemoryBarrier(commandBuffer, transitionImageMemoryBarrierInfo, image);
-            }
-           
-            // copy buffer to image
-            VkBufferImageCopy bufferImageCopy{};
-            bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            bufferImageCopy.imageSubresource.layerCount = 1;
-            bufferImageCopy.imageExtent = VkExtent3D {
-                static_cast<uint32_t>(tinyImage.width),
-                static_cast<uint32_t>(tinyImage.height),
-                1
+    uint64_t UploadQueue::uploadImage(const VkImage image, const VkExtent3D& extent, const void* data, const VkDeviceSize size, const VkImageLayout finalLayout)
+    {
+        assert(size > 0);
+        const StagingRange staging = stage(data, size);
+        const VkCommandBuffer commandBuffer = getCommandBuffer();
+
+        // transition: UNDEFINED -> TRANSFER_DST_OPTIMAL
+        {
+            TransitionImageMemoryBarrierInfo transitionImageMemoryBarrierInfo{
+                0,
+                VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT
             };
+            transitionImageMemoryBarrier(commandBuffer, transitionImageMemoryBarrierInfo, image);
+        }
 
-            vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
+        VkBufferImageCopy bufferImageCopy{};
+        bufferImageCopy.bufferOffset = staging.offset;
+        bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        bufferImageCopy.imageSubresource.layerCount = 1;
+        bufferImageCopy.imageExtent = extent;
+        vkCmdCopyBufferToImage(commandBuffer, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
 
-            // transition: TRANSFER_DST_OPTIMAL -> SHADER_READ_ONLY_OPTIMAL
-            {
-                TransitionImageMemoryBarrierInfo transitionImageMemoryBarrierInfo{
-                    VK_ACCESS_TRANSFER_WRITE_BIT,
-                    VK_ACCESS_SHADER_READ_BIT,
-                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-                };
-                transitionImageMemoryBarrier(commandBuffer, transitionImageMemoryBarrierInfo, image);
-            }
-        VK_CHECK(vkEndCommandBuffer(commandBuffer));
+        // transition: TRANSFER_DST_OPTIMAL -> finalLayout, recorded with the rest of the batch's barriers in flush()
+        VkImageMemoryBarrier imageMemoryBarrier{};
+        imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageMemoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageMemoryBarrier.newLayout = finalLayout;
+        imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.image = image;
+        imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        imageMemoryBarrier.subresourceRange.levelCount = 1;
+        imageMemoryBarrier.subresourceRange.layerCount = 1;
+        imageBarriers.push_back(imageMemoryBarrier);
+
+        return submittedValue + 1;
+    }
+
+    uint64_t UploadQueue::flush()
+    {
+        if (recording == VK_NULL_HANDLE)
+        {
+            return submittedValue;
+        }
+
+        // one barrier makes every copy of the batch visible to whatever the queue runs next
+        VkMemoryBarrier memoryBarrier{};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        vkCmdPipelineBarrier(recording, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memoryBarrier, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+        VK_CHECK(vkEndCommandBuffer(recording));
+
+        const uint64_t value = submittedValue + 1;
+        VkTimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo{};
+        timelineSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineSemaphoreSubmitInfo.signalSemaphoreValueCount = 1;
+        timelineSemaphoreSubmitInfo.pSignalSemaphoreValues = &value;
 
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineSemaphoreSubmitInfo;
         submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
+        submitInfo.pCommandBuffers = &recording;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &semaphore;
+        VK_CHECK(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
+
+        inFlight.push_back({ value, head, recording, std::move(oversized) });
+        submittedValue = value;
+        recording = VK_NULL_HANDLE;
+        oversized.clear();
+        imageBarriers.clear();
+        return value;
+    }
 
-        VkQueue graphicsQueue = deviceContext.getGraphicsQueue();
-        VK_CHECK(vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
-        VK_CHECK(vkQueueWaitIdle(graphicsQueue));
+    bool UploadQueue::isComplete(const uint64_t value)
+    {
+        if (value > completedValue)
+        {
+            reclaim();
+        }
+        return value <= completedValue;
+    }
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+    void UploadQueue::wait(const uint64_t value)
+    {
+        if (value > submittedValue)
+        {
+            flush();
+        }
+        if (value <= completedValue)
+        {
+            return;
+        }
 
-        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+        VkSemaphoreWaitInfo semaphoreWaitInfo{};
+        semaphoreWaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        semaphoreWaitInfo.semaphoreCount = 1;
+        semaphoreWaitInfo.pSemaphores = &semaphore;
+        semaphoreWaitInfo.pValues = &value;
+        VK_CHECK(vkWaitSemaphores(device, &semaphoreWaitInfo, UINT64_MAX));
+        reclaim();
+    }
+
+    VkSemaphore UploadQueue::getSemaphore() const { return semaphore; }
+
+    VkDeviceSize UploadQueue::getStagingSize() const { return stagingSize; }
+
+    UploadQueue::StagingRange UploadQueue::stage(const void* data, const VkDeviceSize size)
+    {
+        if (size > stagingSize)
+        {
+            StagingBuffer staging;
+            staging.allocation = memoryAllocator.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging.buffer);
+            std::memcpy(staging.allocation.mapped, data, static_cast<size_t>(size));
+            oversized.push_back(staging);
+            return { staging.buffer, 0 };
+        }
+
+        const VkDeviceSize offset = reserve(size);
+        std::memcpy(static_cast<std::byte*>(ring.allocation.mapped) + offset, data, static_cast<size_t>(size));
+        return { ring.buffer, offset };
+    }
+
+    VkDeviceSize UploadQueue::reserve(const VkDeviceSize size)
+    {
+        // a multiple of every texel size, as buffer to image copies need
+        constexpr VkDeviceSize ALIGNMENT = 16;
+
+        for (;;)
+        {
+            reclaim();
+            if (tail == head)
+            {
+                // nothing is staged, start over at the beginning so the whole ring is available
+                head = tail = (head + stagingSize - 1) / stagingSize * stagingSize;
+            }
+
+            VkDeviceSize position = (head + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+            if (position % stagingSize + size > stagingSize)
+            {
+                // copies never wrap around, skip the end of the ring
+                position += stagingSize - position % stagingSize;
+            }
+            if (position + size - tail <= stagingSize)
+            {
+                head = position + size;
+                return position % stagingSize;
+            }
+
+            // the ring is full, wait for the oldest batch. if only the current one holds space it has to go first
+            if (inFlight.empty())
+            {
+                flush();
+            }
+            wait(inFlight.front().value);
+        }
+    }
+
+    VkCommandBuffer UploadQueue::getCommandBuffer()
+    {
+        if (recording != VK_NULL_HANDLE)
+        {
+            return recording;
+        }
+
+        if (!idleCommandBuffers.empty())
+        {
+            recording = idleCommandBuffers.back();
+            idleCommandBuffers.pop_back();
+        }
+        else
+        {
+            VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+            commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            commandBufferAllocateInfo.commandPool = commandPool;
+            commandBufferAllocateInfo.commandBufferCount = 1;
+            VK_CHECK(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &recording));
+        }
+
+        // beginning implicitly resets a command buffer of a pool created with RESET_COMMAND_BUFFER_BIT
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK(vkBeginCommandBuffer(recording, &beginInfo));
+        return recording;
+    }
+
+    void UploadQueue::reclaim()
+    {
+        VK_CHECK(vkGetSemaphoreCounterValue(device, semaphore, &completedValue));
+        while (!inFlight.empty() && inFlight.front().value <= completedValue)
+        {
+            Batch& batch = inFlight.front();
+            tail = std::max(tail, batch.ringEnd);
+            for (const StagingBuffer& staging : batch.oversized)
+            {
+                memoryAllocator.destroyBuffer(staging.buffer, staging.allocation);
+            }
+            idleCommandBuffers.push_back(batch.commandBuffer);
+            inFlight.pop_front();
+        }
+    }
+
+    DeviceLocalImageContext::DeviceLocalImageContext(const DeviceContext& deviceContext, UploadQueue& uploadQueue, const tinygltf::Image& tinyImage) : device(deviceContext.getDevice()), memoryAllocator(deviceContext.getMemoryAllocator()), uploadQueue(uploadQueue)
+    {
+        // === create VkImage ===
+        VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+        VkImageCreateInfo imageCreateInfo{};
+        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.extent.width = tinyImage.width;
+        imageCreateInfo.extent.height = tinyImage.height;
+        imageCreateInfo.extent.depth = 1;
+        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.arrayLayers = 1;
+        imageCreateInfo.format = format;
+        imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        allocation = memoryAllocator.createImage(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image);
+
+        // upload pixels
+        VkDeviceSize imageSize = tinyImage.bits / 8 * tinyImage.component * tinyImage.width * tinyImage.height;
+        uploadValue = uploadQueue.uploadImage(image, imageCreateInfo.extent, tinyImage.image.data(), imageSize);
 
         // === create VkImageView ===
         ImageViewContextCreateInfo imageViewContextCreateInfo{};
@@ -1081,10 +1677,11 @@ namespace silk
 
     DeviceLocalImageContext::~DeviceLocalImageContext()
     {
+        // the copy may still sit in an unsubmitted batch, which vkDeviceWaitIdle does not cover
+        uploadQueue.wait(uploadValue);
         vkDeviceWaitIdle(device);
         vkDestroySampler(device, sampler, nullptr);
-        vkFreeMemory(device, deviceMemory, nullptr);
-        vkDestroyImage(device, image, nullptr);
+        memoryAllocator.destroyImage(image, allocation);
         std::cout << "Destroy DeviceLocalImageContext\n";
     }
 
@@ -1092,6 +1689,139 @@ namespace silk
 
     VkImageView DeviceLocalImageContext::getImageView() const { return imageViewContext.has_value() ? imageViewContext->getImageView() : VK_NULL_HANDLE; }
 
+    uint64_t DeviceLocalImageContext::getUploadValue() const { return uploadValue; }
+
+    VkVertexInputBindingDescription InstanceData::getBindingDescription()
+    {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = BINDING;
+        bindingDescription.stride = sizeof(InstanceData);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        return bindingDescription;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> InstanceData::getAttributeDescriptions()
+    {
+        // a mat4 input takes one location per column
+        return {
+            { LOCATION, BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, model) },
+            { LOCATION + 1, BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, model) + sizeof(glm::vec4) },
+            { LOCATION + 2, BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, model) + sizeof(glm::vec4) * 2 },
+            { LOCATION + 3, BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, model) + sizeof(glm::vec4) * 3 },
+            { LOCATION + 4, BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, tint) },
+        };
+    }
+
+    InstanceBufferContext::InstanceBufferContext(const DeviceContext& deviceContext, uint32_t framesInFlight, uint32_t initialCapacity)
+        : device(deviceContext.getDevice()), memoryAllocator(deviceContext.getMemoryAllocator()), framesInFlight(framesInFlight), capacity(std::max(initialCapacity, 1u)), instanceCounts(framesInFlight, 0)
+    {
+        assert(framesInFlight > 0 && framesInFlight <= 32);
+        current = allocate(capacity);
+        std::cout << "Create InstanceBufferContext\n";
+    }
+
+    InstanceBufferContext::~InstanceBufferContext()
+    {
+        vkDeviceWaitIdle(device);
+        for (const RetiredAllocation& retiredAllocation : retired)
+        {
+            release(retiredAllocation.allocation);
+        }
+        release(current);
+        std::cout << "Destroy InstanceBufferContext\n";
+    }
+
+    InstanceData* InstanceBufferContext::map(uint32_t frame, uint32_t count)
+    {
+        assert(frame < framesInFlight);
+
+        // frame's fence was waited on, so its earlier submissions no longer read any retired buffer
+        std::erase_if(retired, [&](RetiredAllocation& retiredAllocation)
+        {
+            retiredAllocation.pendingFrames &= ~(1u << frame);
+            if (retiredAllocation.pendingFrames == 0)
+            {
+                release(retiredAllocation.allocation);
+                return true;
+            }
+            return false;
+        });
+
+        if (count > capacity)
+        {
+            const uint32_t newCapacity = std::max(count, capacity * 2);
+            const Allocation allocation = allocate(newCapacity);
+
+            // every other frame may have work in flight bound to the old buffer, and maps again before its next draw
+            const uint32_t allFrames = framesInFlight == 32 ? UINT32_MAX : (1u << framesInFlight) - 1;
+            const uint32_t pendingFrames = allFrames & ~(1u << frame);
+            if (pendingFrames != 0)
+            {
+                retired.push_back({ current, pendingFrames });
+            }
+            else
+            {
+                release(current);
+            }
+
+            current = allocation;
+            capacity = newCapacity;
+            std::fill(instanceCounts.begin(), instanceCounts.end(), 0);
+        }
+
+        instanceCounts[frame] = count;
+        return current.mapped + static_cast<size_t>(frame) * capacity;
+    }
+
+    uint32_t InstanceBufferContext::update(uint32_t frame, const TransformInterpolator& interpolator, const glm::vec4& tint)
+    {
+        const uint32_t count = static_cast<uint32_t>(interpolator.getEntities().size());
+        InstanceData* instances = map(frame, count);
+        interpolator.writeMatrices(reinterpret_cast<std::byte*>(instances), sizeof(InstanceData));
+        for (uint32_t i = 0; i < count; i++)
+        {
+            instances[i].tint = tint;
+        }
+        return count;
+    }
+
+    uint32_t InstanceBufferContext::update(uint32_t frame, std::span<const glm::mat4> matrices, const glm::vec4& tint)
+    {
+        const uint32_t count = static_cast<uint32_t>(matrices.size());
+        InstanceData* instances = map(frame, count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            instances[i] = InstanceData{ matrices[i], tint };
+        }
+        return count;
+    }
+
+    void InstanceBufferContext::bind(VkCommandBuffer commandBuffer, uint32_t frame) const
+    {
+        assert(frame < framesInFlight);
+        const VkDeviceSize offset = sizeof(InstanceData) * static_cast<VkDeviceSize>(frame) * capacity;
+        vkCmdBindVertexBuffers(commandBuffer, InstanceData::BINDING, 1, &current.buffer, &offset);
+    }
+
+    uint32_t InstanceBufferContext::getInstanceCount(uint32_t frame) const { return instanceCounts[frame]; }
+
+    uint32_t InstanceBufferContext::getCapacity() const { return capacity; }
+
+    InstanceBufferContext::Allocation InstanceBufferContext::allocate(uint32_t newCapacity) const
+    {
+        // host coherent, so writes through the mapping need no flush
+        Allocation allocation{};
+        const VkDeviceSize bufferSize = sizeof(InstanceData) * static_cast<VkDeviceSize>(newCapacity) * framesInFlight;
+        allocation.memory = memoryAllocator.createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, allocation.buffer);
+        allocation.mapped = static_cast<InstanceData*>(allocation.memory.mapped);
+        return allocation;
+    }
+
+    void InstanceBufferContext::release(const Allocation& allocation) const
+    {
+        memoryAllocator.destroyBuffer(allocation.buffer, allocation.memory);
+    }
+
     // glm::mat4 Camera::getOrthoMatrix(uint32_t screenWidth, uint32_t screenHeight) const
     // {
     //     float aspect = static_cast<float>(screenWidth) / screenHeight;
@@ -1101,55 +1831,6 @@ namespace silk
     //     return glm::ortho(-width/2.0f, width/2.0f, -fovYAxis/2.0f, fovYAxis/2.0f, Z_NEAR, Z_FAR);
     // }
 
-    // VkVertexInputBindingDescription InstanceData::getBindingDescription(uint32_t binding)
-    // {
-    //     VkVertexInputBindingDescription bindingDescription{};
-    //     bindingDescription.binding = binding;
-    //     bindingDescription.stride = sizeof(InstanceData);
-    //     bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
-    //     return bindingDescription;
-    // }
-
-    // std::array<VkVertexInputAttributeDescription, 5> InstanceData::getAttributeDescriptions(uint32_t binding, uint32_t location)
-    // {
-    //     std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions;
-
-    //     for (size_t i = 0; i < 4; i++)
-    //     {
-    //         attributeDescriptions[i].location = location + i;
-    //         attributeDescriptions[i].binding = binding;
-    //         attributeDescriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    //         attributeDescriptions[i].offset = offsetof(InstanceData, model) + sizeof(glm::vec4) * i;
-    //     }
-
-    //     attributeDescriptions[4].location = location + 4;
-    //     attributeDescriptions[4].binding = binding;
-    //     attributeDescriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    //     attributeDescriptions[4].offset = offsetof(InstanceData, tint);
-
-    //     return attributeDescriptions;
-    // }
-
-    // void Engine::updateInstanceBuffer(const std::vector<InstanceData>& instances)
-    // {
-    //     size_t instancesSize = instances.size();
-    //     if (instancesSize > maxInstances)
-    //     {
-    //         std::cout << "RECREATE INSTANCE BUFFER!" << std::endl;
-    //         vkDeviceWaitIdle(device);
-    //         cleanupInstanceBuffers();
-
-    //         maxInstances = instancesSize * 2;
-    //         if (createInstanceBuffers() != VK_SUCCESS)
-    //         {
-    //             std::runtime_error("Error: failed to create instance buffers!");
-    //         }
-    //     }
-
-    //     instanceCounts[currentFrame] = instancesSize;
-    //     memcpy(instanceBuffersMapped[currentFrame], instances.data(), instancesSize * sizeof(instances[0]));
-    // }
-
     // void Engine::getCursorWorldSpace(silk::Scene& scene, const silk::Entity& cam, float* x, float* y) const
     // {
     //     double screenPosX, screenPosY;
@@ -1176,23 +1857,4 @@ namespace silk
     // {
     //     return glfwSetMouseButtonCallback(window, callback);
     // }
-
-    // VkResult Engine::createInstanceBuffers()
-    // {
-    //     VkDeviceSize instanceBufferSize = sizeof(InstanceData) * maxInstances;
-    //     for (size_t i = 0; i < static_cast<size_t>(MAX_FRAMES_IN_FLIGHT); i++)
-    //     {
-    //         VkResult result = createBuffer(instanceBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instanceBuffers[i], instanceBuffersMemory[i]);
-    //         if (result != VK_SUCCESS)
-    //         {
-    //             return result;
-    //         }
-    //         result = vkMapMemory(device, instanceBuffersMemory[i], 0, instanceBufferSize, 0, &instanceBuffersMapped[i]);
-    //         if (result != VK_SUCCESS)
-    //         {
-    //             return result;
-    //         }
-    //     }
-    //     return VK_SUCCESS;
-    // }
 }
\ No newline at end of file
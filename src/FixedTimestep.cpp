@@ -0,0 +1,141 @@
+#include "silk/FixedTimestep.h"
+
+#include <cmath>
+#include <numbers>
+
+namespace silk
+{
+    FixedTimestep::FixedTimestep(double tickRate, uint32_t maxTicksPerFrame) : tickDuration(1.0 / tickRate), maxTicksPerFrame(maxTicksPerFrame), lastTime(std::chrono::steady_clock::now())
+    {
+        assert(tickRate > 0.0 && maxTicksPerFrame > 0);
+    }
+
+    uint32_t FixedTimestep::advance(double elapsed)
+    {
+        accumulator += std::max(elapsed, 0.0);
+        uint32_t ticks = 0;
+        while (accumulator >= tickDuration && ticks < maxTicksPerFrame)
+        {
+            accumulator -= tickDuration;
+            ticks++;
+        }
+
+        if (accumulator >= tickDuration)
+        {
+            accumulator = std::fmod(accumulator, tickDuration);
+        }
+        tickCount += ticks;
+        return ticks;
+    }
+
+    uint32_t FixedTimestep::advance()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        const double elapsed = std::chrono::duration<double>(now - lastTime).count();
+        lastTime = now;
+        return advance(elapsed);
+    }
+
+    TransformInterpolator::TransformInterpolator(Scene& scene) : scene(scene)
+    {
+        connections.push_back(scene.onConstruct<Transform>([this](Scene&, Entity e) { record(e); }));
+        connections.push_back(scene.onDestroy<Transform>([this](Scene&, Entity e) { erase(e); }));
+
+        for (Entity e : scene.query<Transform>())
+        {
+            record(e);
+        }
+        lastTick = scene.advanceChangeTick();
+    }
+
+    TransformInterpolator::~TransformInterpolator()
+    {
+        for (Connection connection : connections)
+        {
+            scene.disconnect(connection);
+        }
+    }
+
+    void TransformInterpolator::beginTick()
+    {
+        // an unchanged Transform still matches its recorded state, archetype scenes carry no change ticks
+        if (scene.getStorageMode() == StorageMode::Sparse)
+        {
+            for (Entity e : scene.query<Changed<Transform>>(lastTick))
+            {
+                record(e);
+            }
+        }
+        else
+        {
+            for (Entity e : scene.query<Transform>())
+            {
+                record(e);
+            }
+        }
+        lastTick = scene.advanceChangeTick();
+    }
+
+    void TransformInterpolator::snap(Entity e)
+    {
+        record(e);
+    }
+
+    void TransformInterpolator::interpolate(float alpha)
+    {
+        entities.clear();
+        positionX.clear();
+        positionY.clear();
+        rotation.clear();
+        scaleX.clear();
+        scaleY.clear();
+
+        constexpr float TWO_PI = 2.0f * std::numbers::pi_v<float>;
+        scene.each<const Transform>([&](Entity e, const Transform& transform)
+        {
+            const State& previous = states[entityToState.get(e)];
+            const glm::vec2 position = previous.position + (transform.getPosition() - previous.position) * alpha;
+            const glm::vec2 scale = previous.scale + (transform.getScale() - previous.scale) * alpha;
+            const float turn = std::remainder(transform.getRotation() - previous.rotation, TWO_PI);
+
+            entities.push_back(e);
+            positionX.push_back(position.x);
+            positionY.push_back(position.y);
+            rotation.push_back(previous.rotation + turn * alpha);
+            scaleX.push_back(scale.x);
+            scaleY.push_back(scale.y);
+        });
+    }
+
+    void TransformInterpolator::writeMatrices(std::byte* out, size_t stride, SimdLevel level) const
+    {
+        computeMatrices(TransformArrays{ positionX.data(), positionY.data(), rotation.data(), scaleX.data(), scaleY.data(), entities.size() }, out, stride, level);
+    }
+
+    void TransformInterpolator::record(Entity e)
+    {
+        const Transform& transform = scene.getComponent<const Transform>(e);
+        const State state{ transform.getPosition(), transform.getRotation(), transform.getScale() };
+        if (entityToState.contains(e))
+        {
+            states[entityToState.get(e)] = state;
+            return;
+        }
+
+        entityToState.set(e, static_cast<uint32_t>(states.size()));
+        states.push_back(state);
+        stateOwners.push_back(e);
+    }
+
+    void TransformInterpolator::erase(Entity e)
+    {
+        const uint32_t index = entityToState.get(e);
+        const Entity last = stateOwners.back();
+        states[index] = states.back();
+        stateOwners[index] = last;
+        entityToState.set(last, index);
+        states.pop_back();
+        stateOwners.pop_back();
+        entityToState.erase(e);
+    }
+}
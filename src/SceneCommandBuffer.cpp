@@ -0,0 +1,132 @@
+#include "silk/SceneCommandBuffer.h"
+
+namespace silk
+{
+    SceneCommandBuffer::SceneCommandBuffer(const ThreadPool& threadPool) : threadPool(threadPool), queues(threadPool.getWorkerCount() + 1)
+    {
+        assert(queues.size() <= (PENDING_ENTITY_BIT >> SLOT_SHIFT));
+    }
+
+    Entity SceneCommandBuffer::createEntity()
+    {
+        ThreadQueue& queue = getQueue();
+        assert(queue.createdCount < MAX_PENDING_PER_SLOT);
+        const uint32_t slot = static_cast<uint32_t>(&queue - queues.data());
+        return PENDING_ENTITY_BIT | (slot << SLOT_SHIFT) | queue.createdCount++;
+    }
+
+    void SceneCommandBuffer::deleteEntity(Entity e) { getQueue().deletedEntities.push_back(e); }
+
+    bool SceneCommandBuffer::empty() const
+    {
+        for (const ThreadQueue& queue : queues)
+        {
+            if (queue.createdCount > 0 || !queue.deletedEntities.empty())
+            {
+                return false;
+            }
+
+            for (const auto& commands : queue.componentCommands)
+            {
+                if (commands && !commands->empty())
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void SceneCommandBuffer::playback(Scene& scene)
+    {
+        size_t typeCount = 0;
+        for (ThreadQueue& queue : queues)
+        {
+            queue.created.resize(queue.createdCount);
+            for (Entity& e : queue.created)
+            {
+                e = scene.createEntity();
+            }
+            typeCount = std::max(typeCount, queue.componentCommands.size());
+        }
+
+        // one pass per component type, the first queue that recorded the type gathers the commands of all queues
+        auto findCommands = [this](uint32_t typeID) -> BaseComponentCommands*
+        {
+            for (ThreadQueue& queue : queues)
+            {
+                if (typeID < queue.componentCommands.size() && queue.componentCommands[typeID] && !queue.componentCommands[typeID]->empty())
+                {
+                    return queue.componentCommands[typeID].get();
+                }
+            }
+            return nullptr;
+        };
+
+        for (uint32_t typeID = 0; typeID < typeCount; typeID++)
+        {
+            if (BaseComponentCommands* commands = findCommands(typeID))
+            {
+                commands->playbackAdds(scene, *this, typeID);
+            }
+        }
+
+        for (uint32_t typeID = 0; typeID < typeCount; typeID++)
+        {
+            if (BaseComponentCommands* commands = findCommands(typeID))
+            {
+                commands->playbackRemoves(scene, *this, typeID);
+            }
+        }
+
+        std::vector<Entity> deletedEntities;
+        for (const ThreadQueue& queue : queues)
+        {
+            for (Entity e : queue.deletedEntities)
+            {
+                deletedEntities.push_back(resolve(e));
+            }
+        }
+
+        std::sort(deletedEntities.begin(), deletedEntities.end());
+        deletedEntities.erase(std::unique(deletedEntities.begin(), deletedEntities.end()), deletedEntities.end());
+        scene.deleteEntities(deletedEntities);
+
+        clear();
+    }
+
+    void SceneCommandBuffer::clear()
+    {
+        // keeps every allocation for the next frame
+        for (ThreadQueue& queue : queues)
+        {
+            queue.createdCount = 0;
+            queue.created.clear();
+            queue.deletedEntities.clear();
+            for (auto& commands : queue.componentCommands)
+            {
+                if (commands)
+                {
+                    commands->clear();
+                }
+            }
+        }
+    }
+
+    SceneCommandBuffer::ThreadQueue& SceneCommandBuffer::getQueue()
+    {
+        const uint32_t workerIndex = threadPool.getCurrentWorkerIndex();
+        return queues[workerIndex == ThreadPool::NOT_A_WORKER ? queues.size() - 1 : workerIndex];
+    }
+
+    Entity SceneCommandBuffer::resolve(Entity e) const
+    {
+        if (!(e & PENDING_ENTITY_BIT))
+        {
+            return e;
+        }
+
+        const ThreadQueue& queue = queues[(e & ~PENDING_ENTITY_BIT) >> SLOT_SHIFT];
+        return queue.created[e & (MAX_PENDING_PER_SLOT - 1)];
+    }
+}
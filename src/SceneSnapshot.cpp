@@ -0,0 +1,109 @@
+#include "silk/SceneSnapshot.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace silk
+{
+#ifdef _WIN32
+    MappedFile::MappedFile(const std::string& filename)
+    {
+        fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+        {
+            fileHandle = nullptr;
+            throw std::runtime_error("Error: failed to open " + filename + "!");
+        }
+
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(fileHandle, &fileSize);
+        size = static_cast<size_t>(fileSize.QuadPart);
+        if (size == 0)
+        {
+            return;
+        }
+
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle)
+        {
+            data = static_cast<const std::byte*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        }
+
+        if (!data)
+        {
+            if (mappingHandle)
+            {
+                CloseHandle(mappingHandle);
+            }
+            CloseHandle(fileHandle);
+            throw std::runtime_error("Error: failed to map " + filename + "!");
+        }
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (data)
+        {
+            UnmapViewOfFile(data);
+        }
+        if (mappingHandle)
+        {
+            CloseHandle(mappingHandle);
+        }
+        if (fileHandle)
+        {
+            CloseHandle(fileHandle);
+        }
+    }
+#else
+    MappedFile::MappedFile(const std::string& filename)
+    {
+        const int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Error: failed to open " + filename + "!");
+        }
+
+        struct stat status;
+        if (fstat(fd, &status) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Error: failed to stat " + filename + "!");
+        }
+
+        size = static_cast<size_t>(status.st_size);
+        if (size > 0)
+        {
+            void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                close(fd);
+                throw std::runtime_error("Error: failed to map " + filename + "!");
+            }
+
+            // the whole file is read front to back exactly once
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            data = static_cast<const std::byte*>(mapping);
+        }
+
+        // the mapping stays valid after the descriptor is closed
+        close(fd);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (data)
+        {
+            munmap(const_cast<std::byte*>(data), size);
+        }
+    }
+#endif
+}
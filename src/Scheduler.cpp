@@ -0,0 +1,157 @@
+#include "silk/Scheduler.h"
+
+#include <algorithm>
+#include <latch>
+
+namespace silk
+{
+    namespace
+    {
+        bool intersects(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+        {
+            for (uint32_t typeID : a)
+            {
+                if (std::find(b.begin(), b.end(), typeID) != b.end())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    Scheduler::Scheduler(ThreadPool& threadPool) : threadPool(threadPool), commandBuffer(threadPool) {}
+
+    size_t Scheduler::getSystemCount() const { return systems.size(); }
+
+    SceneCommandBuffer& Scheduler::getCommandBuffer() { return commandBuffer; }
+
+    std::vector<std::string> Scheduler::getDependencies(const std::string& name)
+    {
+        if (graphDirty)
+        {
+            buildGraph();
+        }
+
+        std::vector<std::string> dependencies;
+        for (const System& system : systems)
+        {
+            for (size_t dependent : system.dependents)
+            {
+                if (systems[dependent].name == name)
+                {
+                    dependencies.push_back(system.name);
+                }
+            }
+        }
+        return dependencies;
+    }
+
+    void Scheduler::buildGraph()
+    {
+        for (System& system : systems)
+        {
+            system.dependents.clear();
+            system.dependencyCount = 0;
+        }
+
+        for (size_t j = 0; j < systems.size(); j++)
+        {
+            for (size_t i = 0; i < j; i++)
+            {
+                const System& a = systems[i];
+                const System& b = systems[j];
+                if (intersects(a.writes, b.reads) || intersects(a.writes, b.writes) || intersects(a.reads, b.writes))
+                {
+                    systems[i].dependents.push_back(j);
+                    systems[j].dependencyCount++;
+                }
+            }
+        }
+
+        remainingDependencies = std::make_unique<std::atomic<uint32_t>[]>(systems.size());
+        graphDirty = false;
+    }
+
+    void Scheduler::run(Scene& scene)
+    {
+        if (systems.empty())
+        {
+            commandBuffer.playback(scene);
+            return;
+        }
+
+        if (graphDirty)
+        {
+            buildGraph();
+        }
+
+        scene.lockStructure();
+
+        // create every declared pool up front so systems never grow the scene's pool table concurrently
+        for (System& system : systems)
+        {
+            system.registerComponents(scene);
+            remainingDependencies[&system - systems.data()] = system.dependencyCount;
+        }
+
+        std::latch done(static_cast<std::ptrdiff_t>(systems.size()));
+        std::mutex errorMutex;
+        std::exception_ptr error;
+
+        std::function<void(size_t)> dispatch = [&](size_t index)
+        {
+            threadPool.submit([&, index]
+            {
+                try
+                {
+                    systems[index].fn(scene);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                }
+
+                for (size_t dependent : systems[index].dependents)
+                {
+                    if (remainingDependencies[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    {
+                        dispatch(dependent);
+                    }
+                }
+                done.count_down();
+            });
+        };
+
+        for (size_t i = 0; i < systems.size(); i++)
+        {
+            if (systems[i].dependencyCount == 0)
+            {
+                dispatch(i);
+            }
+        }
+
+        // help out instead of blocking, which also keeps pools without workers from deadlocking
+        while (!done.try_wait())
+        {
+            if (!threadPool.runPendingTask())
+            {
+                std::this_thread::yield();
+            }
+        }
+        scene.unlockStructure();
+
+        // a failed frame's structural changes are dropped rather than half applied
+        if (error)
+        {
+            commandBuffer.clear();
+            std::rethrow_exception(error);
+        }
+
+        commandBuffer.playback(scene);
+    }
+}
@@ -0,0 +1,196 @@
+#include "silk/SpatialGrid.h"
+
+#include <glm/common.hpp>
+
+namespace silk
+{
+    SpatialGrid::SpatialGrid(Scene& scene, float cellSize) : scene(scene), cellSize(cellSize), inverseCellSize(1.0f / cellSize)
+    {
+        assert(cellSize > 0.0f);
+        connections.push_back(scene.onConstruct<Transform>([this](Scene&, Entity e) { insert(e); }));
+        connections.push_back(scene.onDestroy<Transform>([this](Scene&, Entity e) { erase(e); }));
+
+        for (Entity e : scene.query<Transform>())
+        {
+            insert(e);
+        }
+        lastTick = scene.advanceChangeTick();
+    }
+
+    SpatialGrid::~SpatialGrid()
+    {
+        for (Connection connection : connections)
+        {
+            scene.disconnect(connection);
+        }
+    }
+
+    void SpatialGrid::update()
+    {
+        // archetype scenes carry no change ticks, so every entity is checked
+        if (scene.getStorageMode() == StorageMode::Sparse)
+        {
+            for (Entity e : scene.query<Changed<Transform>>(lastTick))
+            {
+                move(e);
+            }
+        }
+        else
+        {
+            for (Entity e : scene.query<Transform>())
+            {
+                move(e);
+            }
+        }
+        lastTick = scene.advanceChangeTick();
+    }
+
+    std::vector<Entity> SpatialGrid::queryAABB(glm::vec2 min, glm::vec2 max) const
+    {
+        std::vector<Entity> entities;
+        queryAABB(min, max, [&](Entity e) { entities.push_back(e); });
+        return entities;
+    }
+
+    std::vector<Entity> SpatialGrid::queryRadius(glm::vec2 center, float radius) const
+    {
+        std::vector<Entity> entities;
+        queryRadius(center, radius, [&](Entity e) { entities.push_back(e); });
+        return entities;
+    }
+
+    std::optional<Entity> SpatialGrid::queryNearest(glm::vec2 point, float maxDistance) const
+    {
+        if (count == 0)
+        {
+            return std::nullopt;
+        }
+
+        const int64_t cx = getCellCoordinate(point.x);
+        const int64_t cy = getCellCoordinate(point.y);
+        const float reach = std::sqrt(maxHalfExtent.x * maxHalfExtent.x + maxHalfExtent.y * maxHalfExtent.y);
+
+        std::optional<Entity> nearest;
+        float bestDistanceSquared = maxDistance * maxDistance;
+        auto visit = [&](int64_t x, int64_t y)
+        {
+            auto it = cellLookup.find(getCellKey(static_cast<int32_t>(x), static_cast<int32_t>(y)));
+            if (it == cellLookup.end())
+            {
+                return;
+            }
+
+            for (const Entry& entry : cells[it->second].entries)
+            {
+                const float distanceSquared = getDistanceSquared(entry, point);
+                if (distanceSquared < bestDistanceSquared || (!nearest && distanceSquared <= bestDistanceSquared))
+                {
+                    bestDistanceSquared = distanceSquared;
+                    nearest = entry.entity;
+                }
+            }
+        };
+
+        // rings closer than the used cell range are empty, start at the first one that can hold entries
+        const int64_t firstRing = std::max({ int64_t(0), minCellX - cx, cx - maxCellX, minCellY - cy, cy - maxCellY });
+        for (int64_t ring = firstRing;; ring++)
+        {
+            // every center in this ring is at least (ring - 1) cells away from point
+            const float ringDistance = static_cast<float>(std::max<int64_t>(ring - 1, 0)) * cellSize - reach;
+            if (ringDistance > 0.0f && ringDistance * ringDistance > bestDistanceSquared)
+            {
+                break;
+            }
+
+            // the previous rings already covered every used cell
+            if (ring > 0 && cx - (ring - 1) <= minCellX && cx + (ring - 1) >= maxCellX && cy - (ring - 1) <= minCellY && cy + (ring - 1) >= maxCellY)
+            {
+                break;
+            }
+
+            if (ring == 0)
+            {
+                visit(cx, cy);
+                continue;
+            }
+
+            for (int64_t x = cx - ring; x <= cx + ring; x++)
+            {
+                visit(x, cy - ring);
+                visit(x, cy + ring);
+            }
+            for (int64_t y = cy - ring + 1; y <= cy + ring - 1; y++)
+            {
+                visit(cx - ring, y);
+                visit(cx + ring, y);
+            }
+        }
+
+        return nearest;
+    }
+
+    void SpatialGrid::insert(Entity e)
+    {
+        const Entry entry = makeEntry(e);
+        const int32_t x = getCellCoordinate(entry.center.x);
+        const int32_t y = getCellCoordinate(entry.center.y);
+        const uint64_t key = getCellKey(x, y);
+        auto [it, inserted] = cellLookup.try_emplace(key, static_cast<uint32_t>(cells.size()));
+        if (inserted)
+        {
+            cells.push_back(Cell{ key, {} });
+        }
+        std::vector<Entry>& entries = cells[it->second].entries;
+
+        if (e >= locations.size())
+        {
+            locations.resize(static_cast<size_t>(e) + 1);
+        }
+        assert(locations[e].slot == UINT32_MAX);
+        locations[e] = Location{ it->second, static_cast<uint32_t>(entries.size()) };
+        entries.push_back(entry);
+        count++;
+
+        maxHalfExtent = glm::max(maxHalfExtent, entry.halfExtent);
+        minCellX = std::min(minCellX, x);
+        minCellY = std::min(minCellY, y);
+        maxCellX = std::max(maxCellX, x);
+        maxCellY = std::max(maxCellY, y);
+    }
+
+    void SpatialGrid::erase(Entity e)
+    {
+        assert(e < locations.size() && locations[e].slot != UINT32_MAX);
+        const Location location = locations[e];
+        std::vector<Entry>& entries = cells[location.cell].entries;
+
+        // swap-and-pop, the moved entry's location follows it
+        entries[location.slot] = entries.back();
+        locations[entries[location.slot].entity].slot = location.slot;
+        entries.pop_back();
+        locations[e] = Location{};
+        count--;
+    }
+
+    void SpatialGrid::move(Entity e)
+    {
+        const Entry entry = makeEntry(e);
+        const Location location = locations[e];
+        Cell& cell = cells[location.cell];
+        if (cell.key == getCellKey(getCellCoordinate(entry.center.x), getCellCoordinate(entry.center.y)))
+        {
+            cell.entries[location.slot] = entry;
+            maxHalfExtent = glm::max(maxHalfExtent, entry.halfExtent);
+            return;
+        }
+
+        erase(e);
+        insert(e);
+    }
+
+    SpatialGrid::Entry SpatialGrid::makeEntry(Entity e) const
+    {
+        const Transform& transform = scene.getComponent<const Transform>(e);
+        return Entry{ e, transform.getPosition(), glm::abs(transform.getScale()) * 0.5f };
+    }
+}
@@ -0,0 +1,145 @@
+#include "silk/ThreadPool.h"
+
+namespace silk
+{
+    namespace
+    {
+        thread_local const ThreadPool* currentPool = nullptr;
+        thread_local uint32_t currentWorkerIndex = ThreadPool::NOT_A_WORKER;
+    }
+
+    ThreadPool::ThreadPool(uint32_t workerCount)
+    {
+        // one queue per worker plus a shared one for tasks submitted from outside the pool
+        queues.reserve(workerCount + 1);
+        for (uint32_t i = 0; i < workerCount + 1; i++)
+        {
+            queues.push_back(std::make_unique<WorkerQueue>());
+        }
+
+        workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++)
+        {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        condition.notify_all();
+
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::submit(std::function<void()> task)
+    {
+        uint32_t queueIndex;
+        if (currentPool == this)
+        {
+            queueIndex = currentWorkerIndex;
+        }
+        else
+        {
+            queueIndex = workers.empty() ? 0 : nextQueue.fetch_add(1, std::memory_order_relaxed) % static_cast<uint32_t>(queues.size());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queues[queueIndex]->mutex);
+            queues[queueIndex]->tasks.push_back(std::move(task));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            pendingTasks.fetch_add(1, std::memory_order_relaxed);
+        }
+        condition.notify_one();
+    }
+
+    bool ThreadPool::runPendingTask()
+    {
+        const uint32_t queueIndex = currentPool == this ? currentWorkerIndex : static_cast<uint32_t>(workers.size());
+
+        std::function<void()> task;
+        if (popTask(queueIndex, task) || stealTask(queueIndex, task))
+        {
+            task();
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t ThreadPool::getWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+
+    uint32_t ThreadPool::getCurrentWorkerIndex() const { return currentPool == this ? currentWorkerIndex : NOT_A_WORKER; }
+
+    ThreadPool& ThreadPool::getDefault()
+    {
+        static ThreadPool threadPool;
+        return threadPool;
+    }
+
+    void ThreadPool::workerLoop(uint32_t workerIndex)
+    {
+        currentPool = this;
+        currentWorkerIndex = workerIndex;
+
+        while (true)
+        {
+            std::function<void()> task;
+            if (popTask(workerIndex, task) || stealTask(workerIndex, task))
+            {
+                task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            condition.wait(lock, [this] { return stopping || pendingTasks.load(std::memory_order_relaxed) > 0; });
+
+            // drain remaining tasks before shutting down
+            if (stopping && pendingTasks.load(std::memory_order_relaxed) == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    bool ThreadPool::popTask(uint32_t queueIndex, std::function<void()>& task)
+    {
+        WorkerQueue& queue = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+        {
+            return false;
+        }
+
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        pendingTasks.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool ThreadPool::stealTask(uint32_t thiefIndex, std::function<void()>& task)
+    {
+        const uint32_t queueCount = static_cast<uint32_t>(queues.size());
+        for (uint32_t offset = 1; offset < queueCount; offset++)
+        {
+            WorkerQueue& queue = *queues[(thiefIndex + offset) % queueCount];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                pendingTasks.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+}
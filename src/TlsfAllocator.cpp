@@ -0,0 +1,244 @@
+#include "silk/TlsfAllocator.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace silk
+{
+    TlsfAllocator::TlsfAllocator(uint64_t size) : size(size)
+    {
+        assert(size > 0);
+        freeHeads.fill(INVALID_NODE);
+        insertFree(createNode(0, size));
+    }
+
+    std::optional<TlsfAllocator::Allocation> TlsfAllocator::allocate(uint64_t size, uint64_t alignment)
+    {
+        assert(size > 0 && std::has_single_bit(alignment));
+
+        // every range in a bucket above the one holding needed fits, whatever its offset
+        const uint64_t needed = size + alignment - 1;
+        uint32_t bucket = getBucket(needed);
+        if (needed >= SL_COUNT && (needed & ((uint64_t(1) << (std::bit_width(needed) - 1 - SL_BITS)) - 1)) != 0)
+        {
+            bucket++;
+        }
+
+        uint32_t node = INVALID_NODE;
+        if (const uint32_t found = findBucket(bucket); found != INVALID_NODE)
+        {
+            node = freeHeads[found];
+        }
+        else
+        {
+            // the buckets below may still hold a range that happens to fit, check them one range at a time
+            for (uint32_t b = findBucket(getBucket(size)); b != INVALID_NODE && b < bucket && node == INVALID_NODE; b = findBucket(b + 1))
+            {
+                for (uint32_t n = freeHeads[b]; n != INVALID_NODE; n = nodes[n].nextFree)
+                {
+                    const uint64_t aligned = (nodes[n].offset + alignment - 1) & ~(alignment - 1);
+                    if (aligned + size <= nodes[n].offset + nodes[n].size)
+                    {
+                        node = n;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (node == INVALID_NODE)
+        {
+            return std::nullopt;
+        }
+
+        removeFree(node);
+        const uint64_t offset = nodes[node].offset;
+        const uint64_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+        if (aligned != offset)
+        {
+            // the padding stays free on its own, its previous neighbour is allocated since free neighbours always merge
+            const uint32_t rest = split(node, aligned - offset);
+            insertFree(node);
+            node = rest;
+        }
+        if (nodes[node].size > size)
+        {
+            insertFree(split(node, size));
+        }
+
+        usedSize += size;
+        allocationCount++;
+        return Allocation{ aligned, size, node };
+    }
+
+    void TlsfAllocator::free(uint32_t node)
+    {
+        assert(node < nodes.size() && !nodes[node].free);
+        usedSize -= nodes[node].size;
+        allocationCount--;
+
+        const uint32_t prev = nodes[node].prevPhysical;
+        if (prev != INVALID_NODE && nodes[prev].free)
+        {
+            removeFree(prev);
+            merge(prev, node);
+            node = prev;
+        }
+
+        const uint32_t next = nodes[node].nextPhysical;
+        if (next != INVALID_NODE && nodes[next].free)
+        {
+            removeFree(next);
+            merge(node, next);
+        }
+
+        insertFree(node);
+    }
+
+    uint64_t TlsfAllocator::getLargestFreeRange() const
+    {
+        if (flBitmap == 0)
+        {
+            return 0;
+        }
+
+        const uint32_t fl = 63 - std::countl_zero(flBitmap);
+        const uint32_t sl = 31 - std::countl_zero(slBitmaps[fl]);
+        uint64_t largest = 0;
+        for (uint32_t n = freeHeads[fl * SL_COUNT + sl]; n != INVALID_NODE; n = nodes[n].nextFree)
+        {
+            largest = std::max(largest, nodes[n].size);
+        }
+        return largest;
+    }
+
+    uint32_t TlsfAllocator::getBucket(uint64_t size)
+    {
+        // sizes below SL_COUNT get a bucket each, above that a power of two is split into SL_COUNT buckets
+        if (size < SL_COUNT)
+        {
+            return static_cast<uint32_t>(size);
+        }
+
+        const uint32_t f = static_cast<uint32_t>(std::bit_width(size)) - 1;
+        const uint32_t fl = f - SL_BITS + 1;
+        const uint32_t sl = static_cast<uint32_t>(size >> (f - SL_BITS)) - SL_COUNT;
+        return fl * SL_COUNT + sl;
+    }
+
+    uint32_t TlsfAllocator::findBucket(uint32_t bucket) const
+    {
+        if (bucket >= FL_COUNT * SL_COUNT)
+        {
+            return INVALID_NODE;
+        }
+
+        uint32_t fl = bucket / SL_COUNT;
+        const uint32_t slMap = slBitmaps[fl] & (~0u << (bucket % SL_COUNT));
+        if (slMap != 0)
+        {
+            return fl * SL_COUNT + std::countr_zero(slMap);
+        }
+
+        const uint64_t flMap = fl + 1 < 64 ? flBitmap & (~uint64_t(0) << (fl + 1)) : 0;
+        if (flMap == 0)
+        {
+            return INVALID_NODE;
+        }
+
+        fl = std::countr_zero(flMap);
+        return fl * SL_COUNT + std::countr_zero(slBitmaps[fl]);
+    }
+
+    uint32_t TlsfAllocator::createNode(uint64_t offset, uint64_t size)
+    {
+        uint32_t node;
+        if (!unusedNodes.empty())
+        {
+            node = unusedNodes.back();
+            unusedNodes.pop_back();
+        }
+        else
+        {
+            node = static_cast<uint32_t>(nodes.size());
+            nodes.emplace_back();
+        }
+
+        nodes[node] = Node{ offset, size };
+        return node;
+    }
+
+    void TlsfAllocator::insertFree(uint32_t node)
+    {
+        const uint32_t bucket = getBucket(nodes[node].size);
+        const uint32_t head = freeHeads[bucket];
+        nodes[node].free = true;
+        nodes[node].prevFree = INVALID_NODE;
+        nodes[node].nextFree = head;
+        if (head != INVALID_NODE)
+        {
+            nodes[head].prevFree = node;
+        }
+        freeHeads[bucket] = node;
+
+        flBitmap |= uint64_t(1) << (bucket / SL_COUNT);
+        slBitmaps[bucket / SL_COUNT] |= 1u << (bucket % SL_COUNT);
+    }
+
+    void TlsfAllocator::removeFree(uint32_t node)
+    {
+        const uint32_t bucket = getBucket(nodes[node].size);
+        const uint32_t prev = nodes[node].prevFree;
+        const uint32_t next = nodes[node].nextFree;
+        if (prev != INVALID_NODE)
+        {
+            nodes[prev].nextFree = next;
+        }
+        else
+        {
+            freeHeads[bucket] = next;
+        }
+        if (next != INVALID_NODE)
+        {
+            nodes[next].prevFree = prev;
+        }
+        nodes[node].free = false;
+
+        if (freeHeads[bucket] == INVALID_NODE)
+        {
+            slBitmaps[bucket / SL_COUNT] &= ~(1u << (bucket % SL_COUNT));
+            if (slBitmaps[bucket / SL_COUNT] == 0)
+            {
+                flBitmap &= ~(uint64_t(1) << (bucket / SL_COUNT));
+            }
+        }
+    }
+
+    uint32_t TlsfAllocator::split(uint32_t node, uint64_t size)
+    {
+        const uint32_t rest = createNode(nodes[node].offset + size, nodes[node].size - size);
+        const uint32_t next = nodes[node].nextPhysical;
+        nodes[rest].prevPhysical = node;
+        nodes[rest].nextPhysical = next;
+        if (next != INVALID_NODE)
+        {
+            nodes[next].prevPhysical = rest;
+        }
+        nodes[node].nextPhysical = rest;
+        nodes[node].size = size;
+        return rest;
+    }
+
+    void TlsfAllocator::merge(uint32_t node, uint32_t next)
+    {
+        const uint32_t after = nodes[next].nextPhysical;
+        nodes[node].size += nodes[next].size;
+        nodes[node].nextPhysical = after;
+        if (after != INVALID_NODE)
+        {
+            nodes[after].prevPhysical = node;
+        }
+        unusedNodes.push_back(next);
+    }
+}
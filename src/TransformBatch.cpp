@@ -0,0 +1,286 @@
+#include "silk/TransformBatch.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SILK_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SILK_TARGET_SSE2
+#define SILK_TARGET_AVX2
+#else
+// only these functions are compiled for the wider instruction sets, everything else keeps the build's baseline
+#define SILK_TARGET_SSE2 __attribute__((target("sse2")))
+#define SILK_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace silk
+{
+    namespace
+    {
+        // Cephes sinf / cosf: reduce to [-pi/4, pi/4] in three steps, then pick the sine or cosine polynomial by octant
+        constexpr float FOUR_OVER_PI = 1.27323954473516f;
+        constexpr float DP1 = 0.78515625f;
+        constexpr float DP2 = 2.4187564849853515625e-4f;
+        constexpr float DP3 = 3.77489497744594108e-8f;
+        constexpr float COS0 = 2.443315711809948e-5f;
+        constexpr float COS1 = -1.388731625493765e-3f;
+        constexpr float COS2 = 4.166664568298827e-2f;
+        constexpr float SIN0 = -1.9515295891e-4f;
+        constexpr float SIN1 = 8.3321608736e-3f;
+        constexpr float SIN2 = -1.6666654611e-1f;
+
+        // translate * rotate * scale, laid out as glm::mat4
+        void writeMatrix(std::byte* out, float positionX, float positionY, float sine, float cosine, float scaleX, float scaleY)
+        {
+            const float matrix[16] = {
+                cosine * scaleX, sine * scaleX, 0.0f, 0.0f,
+                -sine * scaleY, cosine * scaleY, 0.0f, 0.0f,
+                0.0f, 0.0f, 1.0f, 0.0f,
+                positionX, positionY, 0.0f, 1.0f
+            };
+            std::memcpy(out, matrix, sizeof(matrix));
+        }
+
+        void computeScalar(const TransformArrays& t, size_t begin, std::byte* out, size_t stride)
+        {
+            for (size_t i = begin; i < t.count; i++)
+            {
+                writeMatrix(out + i * stride, t.positionX[i], t.positionY[i], sinf(t.rotation[i]), cosf(t.rotation[i]), t.scaleX[i], t.scaleY[i]);
+            }
+        }
+
+#ifdef SILK_X86
+        SILK_TARGET_SSE2 inline void sinCos(__m128 x, __m128& sine, __m128& cosine)
+        {
+            const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(INT32_MIN));
+            __m128 sinSign = _mm_and_ps(x, signMask);
+            x = _mm_andnot_ps(signMask, x);
+
+            // octant, rounded up to even
+            __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(FOUR_OVER_PI)));
+            j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+            const __m128 y = _mm_cvtepi32_ps(j);
+
+            sinSign = _mm_xor_ps(sinSign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29)));
+            const __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+            const __m128 usePolynomial = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+            x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP1)));
+            x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP2)));
+            x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP3)));
+            const __m128 z = _mm_mul_ps(x, x);
+
+            __m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS0), z), _mm_set1_ps(COS1));
+            c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(COS2));
+            c = _mm_mul_ps(_mm_mul_ps(c, z), z);
+            c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+            __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN0), z), _mm_set1_ps(SIN1));
+            s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(SIN2));
+            s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), x), x);
+
+            sine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(usePolynomial, s), _mm_andnot_ps(usePolynomial, c)), sinSign);
+            cosine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(usePolynomial, c), _mm_andnot_ps(usePolynomial, s)), cosSign);
+        }
+
+        SILK_TARGET_SSE2 void computeSSE2(const TransformArrays& t, size_t begin, std::byte* out, size_t stride)
+        {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 column2 = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+            const __m128 zeroOne = _mm_setr_ps(0.0f, 1.0f, 0.0f, 1.0f);
+
+            size_t i = begin;
+            for (; i + 4 <= t.count; i += 4)
+            {
+                __m128 sine, cosine;
+                sinCos(_mm_loadu_ps(t.rotation + i), sine, cosine);
+                const __m128 scaleX = _mm_loadu_ps(t.scaleX + i);
+                const __m128 scaleY = _mm_loadu_ps(t.scaleY + i);
+                const __m128 a = _mm_mul_ps(cosine, scaleX);
+                const __m128 b = _mm_mul_ps(sine, scaleX);
+                const __m128 c = _mm_mul_ps(_mm_sub_ps(zero, sine), scaleY);
+                const __m128 d = _mm_mul_ps(cosine, scaleY);
+                const __m128 e = _mm_loadu_ps(t.positionX + i);
+                const __m128 f = _mm_loadu_ps(t.positionY + i);
+
+                // transpose the six lanes into four matrices
+                const __m128 abLow = _mm_unpacklo_ps(a, b), abHigh = _mm_unpackhi_ps(a, b);
+                const __m128 cdLow = _mm_unpacklo_ps(c, d), cdHigh = _mm_unpackhi_ps(c, d);
+                const __m128 efLow = _mm_unpacklo_ps(e, f), efHigh = _mm_unpackhi_ps(e, f);
+                const __m128 columns0[4] = { _mm_movelh_ps(abLow, zero), _mm_movehl_ps(zero, abLow), _mm_movelh_ps(abHigh, zero), _mm_movehl_ps(zero, abHigh) };
+                const __m128 columns1[4] = { _mm_movelh_ps(cdLow, zero), _mm_movehl_ps(zero, cdLow), _mm_movelh_ps(cdHigh, zero), _mm_movehl_ps(zero, cdHigh) };
+                const __m128 columns3[4] = { _mm_movelh_ps(efLow, zeroOne), _mm_movehl_ps(zeroOne, efLow), _mm_movelh_ps(efHigh, zeroOne), _mm_movehl_ps(zeroOne, efHigh) };
+                for (size_t k = 0; k < 4; k++)
+                {
+                    float* matrix = reinterpret_cast<float*>(out + (i + k) * stride);
+                    _mm_storeu_ps(matrix, columns0[k]);
+                    _mm_storeu_ps(matrix + 4, columns1[k]);
+                    _mm_storeu_ps(matrix + 8, column2);
+                    _mm_storeu_ps(matrix + 12, columns3[k]);
+                }
+            }
+            computeScalar(t, i, out, stride);
+        }
+
+        SILK_TARGET_AVX2 inline void sinCos(__m256 x, __m256& sine, __m256& cosine)
+        {
+            const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(INT32_MIN));
+            __m256 sinSign = _mm256_and_ps(x, signMask);
+            x = _mm256_andnot_ps(signMask, x);
+
+            __m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(FOUR_OVER_PI)));
+            j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+            const __m256 y = _mm256_cvtepi32_ps(j);
+
+            sinSign = _mm256_xor_ps(sinSign, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29)));
+            const __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+            const __m256 usePolynomial = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+
+            x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(DP1)));
+            x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(DP2)));
+            x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(DP3)));
+            const __m256 z = _mm256_mul_ps(x, x);
+
+            __m256 c = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(COS0), z), _mm256_set1_ps(COS1));
+            c = _mm256_add_ps(_mm256_mul_ps(c, z), _mm256_set1_ps(COS2));
+            c = _mm256_mul_ps(_mm256_mul_ps(c, z), z);
+            c = _mm256_add_ps(_mm256_sub_ps(c, _mm256_mul_ps(z, _mm256_set1_ps(0.5f))), _mm256_set1_ps(1.0f));
+
+            __m256 s = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN0), z), _mm256_set1_ps(SIN1));
+            s = _mm256_add_ps(_mm256_mul_ps(s, z), _mm256_set1_ps(SIN2));
+            s = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(s, z), x), x);
+
+            sine = _mm256_xor_ps(_mm256_blendv_ps(c, s, usePolynomial), sinSign);
+            cosine = _mm256_xor_ps(_mm256_blendv_ps(s, c, usePolynomial), cosSign);
+        }
+
+        SILK_TARGET_AVX2 void computeAVX2(const TransformArrays& t, std::byte* out, size_t stride)
+        {
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 column2 = _mm256_setr_ps(0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+            const __m256d zeroOne = _mm256_castps_pd(_mm256_setr_ps(0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f));
+            const __m256d zeroZero = _mm256_castps_pd(zero);
+
+            size_t i = 0;
+            for (; i + 8 <= t.count; i += 8)
+            {
+                __m256 sine, cosine;
+                sinCos(_mm256_loadu_ps(t.rotation + i), sine, cosine);
+                const __m256 scaleX = _mm256_loadu_ps(t.scaleX + i);
+                const __m256 scaleY = _mm256_loadu_ps(t.scaleY + i);
+                const __m256 a = _mm256_mul_ps(cosine, scaleX);
+                const __m256 b = _mm256_mul_ps(sine, scaleX);
+                const __m256 c = _mm256_mul_ps(_mm256_sub_ps(zero, sine), scaleY);
+                const __m256 d = _mm256_mul_ps(cosine, scaleY);
+                const __m256 e = _mm256_loadu_ps(t.positionX + i);
+                const __m256 f = _mm256_loadu_ps(t.positionY + i);
+
+                // pairs of (x, y) as doubles, so a 64-bit unpack moves one column. each register then holds matrix k in
+                // its low and matrix k + 4 in its high 128 bits
+                const __m256d ab[2] = { _mm256_castps_pd(_mm256_unpacklo_ps(a, b)), _mm256_castps_pd(_mm256_unpackhi_ps(a, b)) };
+                const __m256d cd[2] = { _mm256_castps_pd(_mm256_unpacklo_ps(c, d)), _mm256_castps_pd(_mm256_unpackhi_ps(c, d)) };
+                const __m256d ef[2] = { _mm256_castps_pd(_mm256_unpacklo_ps(e, f)), _mm256_castps_pd(_mm256_unpackhi_ps(e, f)) };
+                for (size_t k = 0; k < 4; k++)
+                {
+                    const __m256d abk = ab[k / 2], cdk = cd[k / 2], efk = ef[k / 2];
+                    const bool odd = k % 2 == 1;
+                    const __m256 column0 = _mm256_castpd_ps(odd ? _mm256_unpackhi_pd(abk, zeroZero) : _mm256_unpacklo_pd(abk, zeroZero));
+                    const __m256 column1 = _mm256_castpd_ps(odd ? _mm256_unpackhi_pd(cdk, zeroZero) : _mm256_unpacklo_pd(cdk, zeroZero));
+                    const __m256 column3 = _mm256_castpd_ps(odd ? _mm256_unpackhi_pd(efk, zeroOne) : _mm256_unpacklo_pd(efk, zeroOne));
+
+                    float* low = reinterpret_cast<float*>(out + (i + k) * stride);
+                    _mm256_storeu_ps(low, _mm256_permute2f128_ps(column0, column1, 0x20));
+                    _mm256_storeu_ps(low + 8, _mm256_permute2f128_ps(column2, column3, 0x20));
+                    float* high = reinterpret_cast<float*>(out + (i + k + 4) * stride);
+                    _mm256_storeu_ps(high, _mm256_permute2f128_ps(column0, column1, 0x31));
+                    _mm256_storeu_ps(high + 8, _mm256_permute2f128_ps(column2, column3, 0x31));
+                }
+            }
+            computeSSE2(t, i, out, stride);
+        }
+#endif
+
+        SimdLevel detectSimdLevel()
+        {
+#if defined(SILK_X86) && defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            const bool sse2 = info[3] & (1 << 26);
+            // AVX registers also need the OS to save them on context switches
+            const bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+            __cpuidex(info, 7, 0);
+            if (avx && (info[1] & (1 << 5)))
+            {
+                return SimdLevel::AVX2;
+            }
+            return sse2 ? SimdLevel::SSE2 : SimdLevel::Scalar;
+#elif defined(SILK_X86)
+            if (__builtin_cpu_supports("avx2"))
+            {
+                return SimdLevel::AVX2;
+            }
+            return __builtin_cpu_supports("sse2") ? SimdLevel::SSE2 : SimdLevel::Scalar;
+#else
+            return SimdLevel::Scalar;
+#endif
+        }
+    }
+
+    SimdLevel getSimdLevel()
+    {
+        static const SimdLevel level = detectSimdLevel();
+        return level;
+    }
+
+    void computeMatrices(const TransformArrays& transforms, std::byte* out, size_t stride, SimdLevel level)
+    {
+        assert(stride >= sizeof(glm::mat4) && stride % alignof(float) == 0);
+        assert(level <= getSimdLevel());
+
+#ifdef SILK_X86
+        switch (level)
+        {
+        case SimdLevel::AVX2:
+            computeAVX2(transforms, out, stride);
+            return;
+        case SimdLevel::SSE2:
+            computeSSE2(transforms, 0, out, stride);
+            return;
+        case SimdLevel::Scalar:
+            break;
+        }
+#endif
+        computeScalar(transforms, 0, out, stride);
+    }
+
+    void computeMatrices(std::span<const Transform> transforms, std::byte* out, size_t stride, SimdLevel level)
+    {
+        // deinterleaved a block at a time into stack arrays that stay in L1
+        constexpr size_t BLOCK_SIZE = 256;
+        alignas(32) float positionX[BLOCK_SIZE], positionY[BLOCK_SIZE], rotation[BLOCK_SIZE], scaleX[BLOCK_SIZE], scaleY[BLOCK_SIZE];
+
+        for (size_t first = 0; first < transforms.size(); first += BLOCK_SIZE)
+        {
+            const size_t count = std::min(BLOCK_SIZE, transforms.size() - first);
+            for (size_t i = 0; i < count; i++)
+            {
+                const Transform& transform = transforms[first + i];
+                const glm::vec2 position = transform.getPosition();
+                const glm::vec2 scale = transform.getScale();
+                positionX[i] = position.x;
+                positionY[i] = position.y;
+                rotation[i] = transform.getRotation();
+                scaleX[i] = scale.x;
+                scaleY[i] = scale.y;
+            }
+
+            computeMatrices(TransformArrays{ positionX, positionY, rotation, scaleX, scaleY, count }, out + first * stride, stride, level);
+        }
+    }
+}
@@ -0,0 +1,205 @@
+#include "silk/TransformHierarchy.h"
+
+#include <atomic>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+namespace silk
+{
+    TransformHierarchy::TransformHierarchy(Scene& scene) : scene(scene)
+    {
+        auto markStructureDirty = [this](Scene&, Entity) { structureDirty = true; };
+        connections.push_back(scene.onConstruct<Parent>(markStructureDirty));
+        connections.push_back(scene.onUpdate<Parent>(markStructureDirty));
+        connections.push_back(scene.onDestroy<Parent>(markStructureDirty));
+        connections.push_back(scene.onConstruct<Transform>(markStructureDirty));
+        connections.push_back(scene.onDestroy<Transform>(markStructureDirty));
+    }
+
+    TransformHierarchy::~TransformHierarchy()
+    {
+        for (Connection connection : connections)
+        {
+            scene.disconnect(connection);
+        }
+    }
+
+    void TransformHierarchy::update(ThreadPool* threadPool, size_t grainSize)
+    {
+        // a Parent edited in place through getComponent() is only visible through its change tick
+        if (!structureDirty && scene.getStorageMode() == StorageMode::Sparse && !scene.query<Changed<Parent>>(lastTick).empty())
+        {
+            structureDirty = true;
+        }
+
+        if (structureDirty)
+        {
+            rebuild();
+            structureDirty = false;
+        }
+        else
+        {
+            markChanged();
+        }
+        lastTick = scene.advanceChangeTick();
+
+        ThreadPool& pool = threadPool ? *threadPool : ThreadPool::getDefault();
+        std::atomic<size_t> recomputed = 0;
+        for (size_t depth = 0; depth + 1 < levelStarts.size(); depth++)
+        {
+            const size_t begin = levelStarts[depth];
+            const size_t end = levelStarts[depth + 1];
+            if (end - begin > grainSize)
+            {
+                pool.parallelFor(end - begin, grainSize, [&](size_t rangeBegin, size_t rangeEnd)
+                {
+                    computeRange(begin + rangeBegin, begin + rangeEnd, recomputed);
+                });
+            }
+            else
+            {
+                computeRange(begin, end, recomputed);
+            }
+        }
+
+        recomputedCount = recomputed.load(std::memory_order_relaxed);
+        std::fill(dirty.begin(), dirty.end(), 0);
+    }
+
+    const glm::mat4& TransformHierarchy::getWorldMatrix(Entity e) const
+    {
+        assert(entityToNode.contains(e));
+        return worldMatrices[entityToNode.get(e)];
+    }
+
+    void TransformHierarchy::rebuild()
+    {
+        auto getParent = [this](Entity e) -> std::optional<Entity>
+        {
+            if (scene.hasComponent<Parent>(e))
+            {
+                const Entity parent = scene.getComponent<const Parent>(e).entity;
+                if (parent != e && scene.hasComponent<Transform>(parent))
+                {
+                    return parent;
+                }
+            }
+            return std::nullopt;
+        };
+
+        // depth of every entity, each parent chain is walked once and memoised
+        const std::vector<Entity> all = scene.query<Transform>();
+        SparseIndex depths;
+        std::vector<Entity> path;
+        std::vector<uint32_t> levelSizes;
+        for (Entity e : all)
+        {
+            path.clear();
+            uint32_t depth = 0;
+            for (Entity current = e;;)
+            {
+                if (depths.contains(current))
+                {
+                    depth = depths.get(current) + 1;
+                    break;
+                }
+
+                path.push_back(current);
+                // a chain longer than the number of entities revisits one, checked in release builds too since
+                // Parent components are user data
+                if (path.size() > all.size())
+                {
+                    throw std::runtime_error("Error: Parent components of entity " + std::to_string(e) + " form a cycle!");
+                }
+                const std::optional<Entity> parent = getParent(current);
+                if (!parent)
+                {
+                    break;
+                }
+                current = *parent;
+            }
+
+            for (auto it = path.rbegin(); it != path.rend(); ++it, depth++)
+            {
+                depths.set(*it, depth);
+                if (depth >= levelSizes.size())
+                {
+                    levelSizes.resize(depth + 1);
+                }
+                levelSizes[depth]++;
+            }
+        }
+
+        levelStarts.assign(levelSizes.size() + 1, 0);
+        for (size_t depth = 0; depth < levelSizes.size(); depth++)
+        {
+            levelStarts[depth + 1] = levelStarts[depth] + levelSizes[depth];
+        }
+
+        // the previous nodes are only dropped once the new structure is known to be valid
+        for (Entity e : entities)
+        {
+            entityToNode.erase(e);
+        }
+
+        // counting sort by depth, entities of one level keep the Transform pool's order
+        std::vector<uint32_t> next(levelStarts.begin(), levelStarts.end() - 1);
+        entities.resize(all.size());
+        for (Entity e : all)
+        {
+            const uint32_t node = next[depths.get(e)]++;
+            entities[node] = e;
+            entityToNode.set(e, node);
+        }
+
+        parentNodes.resize(entities.size());
+        for (size_t node = 0; node < entities.size(); node++)
+        {
+            const std::optional<Entity> parent = getParent(entities[node]);
+            parentNodes[node] = parent ? entityToNode.get(*parent) : NO_NODE;
+        }
+
+        worldMatrices.resize(entities.size());
+        dirty.assign(entities.size(), 1);
+    }
+
+    void TransformHierarchy::markChanged()
+    {
+        // archetype scenes carry no change ticks, so everything is recomputed
+        if (scene.getStorageMode() != StorageMode::Sparse)
+        {
+            std::fill(dirty.begin(), dirty.end(), 1);
+            return;
+        }
+
+        for (Entity e : scene.query<Changed<Transform>>(lastTick))
+        {
+            dirty[entityToNode.get(e)] = 1;
+        }
+    }
+
+    void TransformHierarchy::computeRange(size_t begin, size_t end, std::atomic<size_t>& recomputed)
+    {
+        size_t count = 0;
+        for (size_t node = begin; node < end; node++)
+        {
+            // parents sit on an earlier level, so their dirty flag is final by now
+            const uint32_t parent = parentNodes[node];
+            if (parent != NO_NODE && dirty[parent])
+            {
+                dirty[node] = 1;
+            }
+
+            if (!dirty[node])
+            {
+                continue;
+            }
+
+            const glm::mat4 local = scene.getComponent<const Transform>(entities[node]).getMatrix();
+            worldMatrices[node] = parent != NO_NODE ? worldMatrices[parent] * local : local;
+            count++;
+        }
+        recomputed.fetch_add(count, std::memory_order_relaxed);
+    }
+}
@@ -1,4 +1,15 @@
 #include "silk/ECS.h"
+#include "silk/SceneCommandBuffer.h"
+#include "silk/SceneSnapshot.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
 
 using namespace silk;
 
@@ -7,6 +18,45 @@ struct Velocity { float dx, dy; };
 struct Health { int hp; };
 struct Name { std::string value; };
 
+struct Particle { float x, y, z; };
+
+template <>
+struct silk::ComponentTraits<Particle>
+{
+    static constexpr bool PAGED = true;
+};
+
+// counts copies and moves to check that storage never copies components
+struct Tracked
+{
+    static inline int copies = 0;
+    static inline int moves = 0;
+
+    int value = 0;
+
+    Tracked(int v) : value(v) {}
+    Tracked(const Tracked& other) : value(other.value) { copies++; }
+    Tracked(Tracked&& other) noexcept : value(other.value) { moves++; }
+    Tracked& operator=(const Tracked& other) { value = other.value; copies++; return *this; }
+    Tracked& operator=(Tracked&& other) noexcept { value = other.value; moves++; return *this; }
+};
+
+// ThreadPool workers allocate too
+static std::atomic<size_t> allocationCount{0};
+
+void* operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
 int main()
 {
     // addComponent()
@@ -76,5 +126,711 @@ int main()
         assert(emptyResult.empty());
     }
 
+    // view() / each()
+    {
+        Scene scene;
+        Entity a = scene.createEntity(Position{1, 1}, Velocity{1, 0});
+        scene.createEntity(Position{2, 2});
+        Entity c = scene.createEntity(Position{3, 3}, Velocity{0, 1});
+
+        int visited = 0;
+        for (auto [e, pos, vel] : scene.view<Position, const Velocity>())
+        {
+            assert(e == a || e == c);
+            pos.x += vel.dx;
+            pos.y += vel.dy;
+            visited++;
+        }
+        assert(visited == 2);
+        assert(scene.getComponent<Position>(a).x == 2 && scene.getComponent<Position>(a).y == 1);
+        assert(scene.getComponent<Position>(c).x == 3 && scene.getComponent<Position>(c).y == 4);
+
+        visited = 0;
+        scene.each<Position, Velocity>([&](Entity e, Position& pos, Velocity&)
+        {
+            assert(pos.x == scene.getComponent<Position>(e).x);
+            visited++;
+        });
+        assert(visited == 2);
+
+        visited = 0;
+        scene.each<const Position>([&](const Position&) { visited++; });
+        assert(visited == 3);
+
+        for ([[maybe_unused]] auto [e, name] : scene.view<Name>())
+        {
+            assert(false);
+        }
+    }
+
+    // StorageMode::Archetype
+    {
+        Scene scene(StorageMode::Archetype);
+        assert(scene.getStorageMode() == StorageMode::Archetype);
+
+        Entity a = scene.createEntity(Position{1, 1}, Velocity{1, 0}, Name{"a"});
+        Entity b = scene.createEntity(Position{2, 2}, Name{"b"});
+        Entity c = scene.createEntity(Velocity{0, 1}, Position{3, 3}, Name{"c"});
+
+        assert(scene.getComponent<Name>(a).value == "a");
+        assert(scene.getComponent<Name>(b).value == "b");
+        assert(scene.getComponent<Velocity>(c).dy == 1);
+
+        auto result = scene.query<Position, Velocity>();
+        assert(result.size() == 2);
+        assert(result[0] != b && result[1] != b);
+
+        scene.each<Position, const Velocity>([](Position& pos, const Velocity& vel)
+        {
+            pos.x += vel.dx;
+            pos.y += vel.dy;
+        });
+        assert(scene.getComponent<Position>(a).x == 2);
+        assert(scene.getComponent<Position>(c).y == 4);
+
+        scene.removeComponent<Velocity>(a);
+        assert(!scene.hasComponent<Velocity>(a));
+        assert(scene.getComponent<Name>(a).value == "a");
+        assert((scene.query<Position, Velocity>().size() == 1));
+
+        scene.deleteEntity(b);
+        assert(!scene.hasComponent<Position>(b));
+        assert(scene.getComponent<Name>(c).value == "c");
+        assert(scene.query<Name>().size() == 2);
+
+        // spill over several chunks and remove from the middle
+        std::vector<Entity> entities;
+        for (int i = 0; i < 5000; i++)
+        {
+            entities.push_back(scene.createEntity(Health{i}, Name{std::to_string(i)}));
+        }
+
+        for (int i = 0; i < 5000; i += 3)
+        {
+            scene.deleteEntity(entities[i]);
+        }
+
+        for (int i = 0; i < 5000; i++)
+        {
+            assert(scene.hasComponent<Health>(entities[i]) == (i % 3 != 0));
+            if (i % 3 != 0)
+            {
+                assert(scene.getComponent<Health>(entities[i]).hp == i);
+                assert(scene.getComponent<Name>(entities[i]).value == std::to_string(i));
+            }
+        }
+    }
+
+    // parallelEach()
+    for (StorageMode storageMode : { StorageMode::Sparse, StorageMode::Archetype })
+    {
+        ThreadPool threadPool(3);
+        Scene scene(storageMode);
+        scene.setThreadPool(&threadPool);
+        for (int i = 0; i < 20000; i++)
+        {
+            Entity e = scene.createEntity(Position{0, 0}, Health{i});
+            if (i % 2 == 0)
+            {
+                scene.addComponent(e, Velocity{1, 2});
+            }
+        }
+
+        std::atomic<int> visited = 0;
+        scene.parallelEach<Position, const Velocity>([&](Position& pos, const Velocity& vel)
+        {
+            assert(scene.isStructureLocked());
+            pos.x += vel.dx;
+            pos.y += vel.dy;
+            visited++;
+        }, 256);
+        assert(visited == 10000);
+        assert(!scene.isStructureLocked());
+
+        scene.each<const Position, const Health>([](const Position& pos, const Health& health)
+        {
+            assert((health.hp % 2 == 0) == (pos.x == 1 && pos.y == 2));
+        });
+    }
+
+    // SceneCommandBuffer
+    for (StorageMode storageMode : { StorageMode::Sparse, StorageMode::Archetype })
+    {
+        ThreadPool threadPool(3);
+        Scene scene(storageMode);
+        scene.setThreadPool(&threadPool);
+        SceneCommandBuffer commandBuffer(threadPool);
+        assert(commandBuffer.empty());
+
+        for (int i = 0; i < 10000; i++)
+        {
+            scene.createEntity(Health{i});
+        }
+
+        // every entity with an even hp spawns a child, odd ones lose their Health, multiples of 5 are deleted
+        scene.parallelEach<const Health>([&](Entity e, const Health& health)
+        {
+            if (health.hp % 2 == 0)
+            {
+                Entity child = commandBuffer.createEntity();
+                commandBuffer.addComponent(child, Position{static_cast<float>(health.hp), 0});
+                commandBuffer.addComponent(child, Name{std::to_string(health.hp)});
+            }
+            else
+            {
+                commandBuffer.removeComponent<Health>(e);
+            }
+
+            if (health.hp % 5 == 0)
+            {
+                commandBuffer.deleteEntity(e);
+            }
+        }, 128);
+        assert(!commandBuffer.empty());
+        assert(scene.query<Health>().size() == 10000);
+
+        commandBuffer.playback(scene);
+        assert(commandBuffer.empty());
+
+        auto children = scene.query<Position, Name>();
+        assert(children.size() == 5000);
+        for (Entity child : children)
+        {
+            const Position& pos = scene.getComponent<Position>(child);
+            assert(scene.getComponent<Name>(child).value == std::to_string(static_cast<int>(pos.x)));
+        }
+
+        // 5000 odd entities lost Health, 1000 of the remaining even ones were deleted
+        assert(scene.query<Health>().size() == 4000);
+        scene.each<const Health>([](const Health& health) { assert(health.hp % 2 == 0 && health.hp % 5 != 0); });
+    }
+
+    // createEntities() / deleteEntities()
+    for (StorageMode storageMode : { StorageMode::Sparse, StorageMode::Archetype })
+    {
+        Scene scene(storageMode);
+        Entity freed = scene.createEntity();
+        scene.deleteEntity(freed);
+
+        std::vector<Entity> entities = scene.createEntities(1000, Position{1, 2}, Name{"particle"});
+        assert(entities.size() == 1000);
+        assert(entities[0] == freed);
+        for (Entity e : entities)
+        {
+            assert(scene.getComponent<Position>(e).y == 2);
+            assert(scene.getComponent<Name>(e).value == "particle");
+        }
+
+        std::vector<Entity> withHealth = scene.createEntities(10, Health{7});
+        assert(withHealth[0] == 1000);
+
+        // a small batch goes through swap-and-pop, a large one through compaction
+        std::vector<Entity> few(entities.begin(), entities.begin() + 10);
+        few.push_back(withHealth[3]);
+        scene.deleteEntities(few);
+        assert((scene.query<Position, Name>().size() == 990));
+        assert(scene.query<Health>().size() == 9);
+
+        std::vector<Entity> many;
+        for (size_t i = 10; i < entities.size(); i += 2)
+        {
+            many.push_back(entities[i]);
+        }
+        scene.deleteEntities(many);
+        assert(scene.query<Position>().size() == 495);
+        for (size_t i = 10; i < entities.size(); i++)
+        {
+            assert(scene.hasComponent<Name>(entities[i]) == (i % 2 == 1));
+        }
+
+        Entity reused = scene.createEntity();
+        assert(reused == many.back());
+    }
+
+    // sparse index spanning several pages
+    {
+        Scene scene;
+        std::vector<Entity> entities;
+        for (int i = 0; i < 10000; i++)
+        {
+            entities.push_back(scene.createEntity(Health{i}));
+        }
+
+        for (int i = 0; i < 10000; i += 2)
+        {
+            scene.removeComponent<Health>(entities[i]);
+        }
+
+        for (int i = 0; i < 10000; i++)
+        {
+            assert(scene.hasComponent<Health>(entities[i]) == (i % 2 == 1));
+            if (i % 2 == 1)
+            {
+                assert(scene.getComponent<Health>(entities[i]).hp == i);
+            }
+        }
+    }
+
+    // emplaceComponent() and removal never copy components
+    for (StorageMode mode : {StorageMode::Sparse, StorageMode::Archetype})
+    {
+        Scene scene(mode);
+        std::vector<Entity> entities;
+        for (int i = 0; i < 100; i++)
+        {
+            Entity e = scene.createEntity();
+            Tracked& tracked = scene.emplaceComponent<Tracked>(e, i);
+            assert(tracked.value == i);
+            entities.push_back(e);
+        }
+        entities.push_back(scene.createEntity(Tracked{100}, Position{0, 0}));
+
+        for (int i = 0; i < 100; i += 3)
+        {
+            scene.removeComponent<Tracked>(entities[i]);
+        }
+        scene.deleteEntity(entities[1]);
+        assert(scene.getComponent<Tracked>(entities[100]).value == 100);
+        assert(scene.getComponent<Tracked>(entities[2]).value == 2);
+        assert(Tracked::copies == 0);
+        Tracked::moves = 0;
+    }
+
+    // adding to a warm pool allocates nothing beyond the moved-in value, removing allocates nothing
+    {
+        Scene scene;
+        std::vector<Entity> entities;
+        for (int i = 0; i < 128; i++)
+        {
+            entities.push_back(scene.createEntity(Name{std::string(100, 'x')}));
+        }
+        for (int i = 64; i < 128; i++)
+        {
+            scene.removeComponent<Name>(entities[i]);
+        }
+
+        std::string value(100, 'y');
+        size_t before = allocationCount;
+        scene.emplaceComponent<Name>(entities[64], std::move(value));
+        assert(allocationCount == before);
+
+        before = allocationCount;
+        scene.removeComponent<Name>(entities[10]);
+        scene.removeComponent<Name>(entities[20]);
+        assert(allocationCount == before);
+        assert(scene.getComponent<Name>(entities[64]).value == std::string(100, 'y'));
+        assert(scene.getComponent<Name>(entities[63]).value == std::string(100, 'x'));
+    }
+
+    // ComponentMask
+    {
+        ComponentMask mask;
+        mask.set(3);
+        mask.set(64);
+        mask.set(127);
+        std::vector<uint32_t> bits;
+        mask.forEach([&](uint32_t typeID) { bits.push_back(typeID); });
+        assert((bits == std::vector<uint32_t>{3, 64, 127}));
+
+        ComponentMask required;
+        required.set(64);
+        assert(mask.containsAll(required));
+        required.set(65);
+        assert(!mask.containsAll(required));
+        mask.reset(64);
+        assert(!mask.test(64) && mask.test(127));
+
+        // out of range IDs fail loudly instead of writing past the mask, also with NDEBUG
+        bool threw = false;
+        try
+        {
+            mask.set(ComponentMask::MAX_COMPONENT_TYPES);
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+        assert(threw);
+        threw = false;
+        try
+        {
+            mask.reset(200);
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+        assert(threw && !mask.test(200));
+    }
+
+    // query() and deleteEntity() follow the entity's component mask
+    {
+        Scene scene;
+        Entity a = scene.createEntity(Position{0, 0}, Velocity{1, 1}, Health{1});
+        Entity b = scene.createEntity(Position{1, 1}, Health{2});
+        Entity c = scene.createEntity(Velocity{2, 2}, Health{3});
+        scene.createEntity(Name{"unrelated"});
+
+        assert((scene.query<Position, Health>() == std::vector<Entity>{a, b}));
+        assert((scene.query<Health, Velocity>() == std::vector<Entity>{a, c}));
+
+        scene.removeComponent<Health>(a);
+        assert((scene.query<Position, Health>() == std::vector<Entity>{b}));
+
+        scene.deleteEntity(b);
+        assert(scene.query<Position>() == std::vector<Entity>{a});
+        assert(scene.query<Health>() == std::vector<Entity>{c});
+        assert(scene.query<Name>().size() == 1);
+
+        Entity reused = scene.createEntity(Velocity{3, 3});
+        assert(reused == b);
+        assert(!scene.hasComponent<Position>(reused));
+        assert((scene.query<Position, Velocity>() == std::vector<Entity>{a}));
+
+        Entity entities[] = {a, c};
+        scene.deleteEntities(entities);
+        assert(scene.query<Velocity>() == std::vector<Entity>{reused});
+        assert(scene.query<Health>().empty());
+    }
+
+    // Changed<T> and Added<T> query filters
+    {
+        Scene scene;
+        std::vector<Entity> entities = scene.createEntities(10, Position{0, 0}, Velocity{1, 1});
+        assert((scene.query<Added<Position>>().size() == 10));
+
+        const uint32_t lastRun = scene.advanceChangeTick();
+        assert(scene.query<Changed<Position>>(lastRun).empty());
+
+        scene.getComponent<Position>(entities[2]).x = 1;
+        assert(scene.getComponent<const Position>(entities[3]).x == 0);
+        scene.each<Position, const Velocity>([&](Entity e, Position& position, const Velocity&)
+        {
+            if (e == entities[7])
+            {
+                position.x = 2;
+            }
+        });
+        assert((scene.query<Changed<Position>>(lastRun).size() == 10));
+        assert((scene.query<Changed<Velocity>>(lastRun).empty()));
+
+        const uint32_t nextRun = scene.advanceChangeTick();
+        scene.getComponent<Position>(entities[2]).x = 3;
+        scene.removeComponent<Velocity>(entities[0]);
+        Entity added = scene.createEntity(Position{4, 4});
+        assert((scene.query<Changed<Position>>(nextRun) == std::vector<Entity>{entities[2], added}));
+        assert((scene.query<Velocity, Changed<Position>>(nextRun) == std::vector<Entity>{entities[2]}));
+        assert(scene.query<Added<Position>>(nextRun) == std::vector<Entity>{added});
+        assert((scene.query<Added<Position>>(lastRun).size() == 1));
+    }
+
+    // group() keeps owned pools packed and in lockstep
+    {
+        Scene scene;
+        std::vector<Entity> entities;
+        for (int i = 0; i < 100; i++)
+        {
+            Entity e = scene.createEntity(Position{static_cast<float>(i), 0});
+            if (i % 3 == 0)
+            {
+                scene.addComponent(e, Velocity{static_cast<float>(i), 0});
+            }
+            entities.push_back(e);
+        }
+
+        auto checkGroup = [&](const Group<const Position, const Velocity>& group, size_t expected)
+        {
+            assert(group.size() == expected);
+            assert((scene.query<Position, Velocity>().size() == expected));
+            group.each([&](Entity e, const Position& position, const Velocity& velocity)
+            {
+                assert(position.x == velocity.dx);
+                assert(scene.hasComponent<Position>(e) && scene.hasComponent<Velocity>(e));
+            });
+        };
+
+        Group<const Position, const Velocity> group = scene.group<const Position, const Velocity>();
+        checkGroup(group, 34);
+
+        scene.addComponent(entities[1], Velocity{1, 0});
+        scene.removeComponent<Velocity>(entities[0]);
+        scene.removeComponent<Position>(entities[3]);
+        checkGroup(group, 33);
+
+        scene.deleteEntity(entities[6]);
+        Entity created = scene.createEntity(Velocity{500, 0}, Position{500, 0});
+        checkGroup(group, 33);
+
+        std::vector<Entity> batch = scene.createEntities(20, Position{7, 0}, Velocity{7, 0});
+        checkGroup(group, 53);
+
+        std::vector<Entity> many(entities.begin() + 10, entities.end());
+        many.push_back(created);
+        scene.deleteEntities(many);
+        checkGroup(group, 22);
+
+        Group<Position, Velocity> same = scene.group<Position, Velocity>();
+        same.each([](Position& position, Velocity&) { position.y = 1; });
+        assert(scene.getComponent<Position>(batch[0]).y == 1);
+    }
+
+    // sort() and sortAs()
+    {
+        Scene scene;
+        std::vector<Entity> entities;
+        for (int i = 0; i < 64; i++)
+        {
+            entities.push_back(scene.createEntity(Tracked{63 - i}, Health{63 - i}));
+        }
+
+        Tracked::moves = 0;
+        scene.sort<Tracked>([](const Tracked& a, const Tracked& b) { return a.value < b.value; });
+        // reversing is 32 swaps, each cycle of two costs three moves
+        assert(Tracked::moves == 96);
+        assert(Tracked::copies == 0);
+
+        int previous = -1;
+        scene.each<const Tracked>([&](Entity e, const Tracked& tracked)
+        {
+            assert(tracked.value > previous);
+            assert(scene.getComponent<const Health>(e).hp == tracked.value);
+            previous = tracked.value;
+        });
+
+        scene.getComponent<Tracked>(entities[10]).value = 70;
+        scene.sort<Tracked>([](const Tracked& a, const Tracked& b) { return a.value < b.value; }, SortMode::Insertion);
+        previous = -1;
+        scene.each<const Tracked>([&](const Tracked& tracked) { assert(tracked.value > previous); previous = tracked.value; });
+        assert(scene.getComponent<const Tracked>(entities[10]).value == 70);
+
+        scene.sortAs<Health, Tracked>();
+        std::vector<Entity> healthOrder, trackedOrder;
+        scene.each<const Health>([&](Entity e, const Health&) { healthOrder.push_back(e); });
+        scene.each<const Tracked>([&](Entity e, const Tracked&) { trackedOrder.push_back(e); });
+        assert(healthOrder == trackedOrder);
+
+        scene.sort<Health>([](Entity a, Entity b) { return a < b; });
+        assert(scene.query<Health>() == entities);
+    }
+
+    // sort() of a pool owned by a group keeps the group in lockstep
+    {
+        Scene scene;
+        for (int i = 0; i < 50; i++)
+        {
+            Entity e = scene.createEntity(Position{static_cast<float>(50 - i), 0});
+            if (i % 2 == 0)
+            {
+                scene.addComponent(e, Velocity{static_cast<float>(50 - i), 0});
+            }
+        }
+
+        auto group = scene.group<const Position, const Velocity>();
+        scene.sort<Position>([](const Position& a, const Position& b) { return a.x < b.x; });
+
+        float previous = 0;
+        group.each([&](const Position& position, const Velocity& velocity)
+        {
+            assert(position.x == velocity.dx);
+            assert(position.x > previous);
+            previous = position.x;
+        });
+        assert(group.size() == 25);
+    }
+
+    // SceneSnapshot
+    {
+        const std::string filename = "ecs_test_snapshot.bin";
+        Scene saved;
+        std::vector<Entity> entities;
+        for (int i = 0; i < 5000; i++)
+        {
+            Entity e = saved.createEntity(Position{static_cast<float>(i), 1});
+            if (i % 2 == 0)
+            {
+                saved.addComponent(e, Health{i});
+            }
+            entities.push_back(e);
+        }
+        saved.deleteEntity(entities[7]);
+        saved.deleteEntity(entities[42]);
+        SceneSnapshot::save<Position, Health>(saved, filename);
+
+        Scene loaded;
+        SceneSnapshot::load<Position, Health>(loaded, filename);
+        assert((loaded.query<Position>() == saved.query<Position>()));
+        assert((loaded.query<Position, Health>() == saved.query<Position, Health>()));
+        assert(loaded.getComponent<const Position>(entities[100]).x == 100);
+        assert(loaded.getComponent<const Health>(entities[100]).hp == 100);
+        assert(!loaded.hasComponent<Health>(entities[101]));
+        assert(loaded.createEntity() == entities[42]);
+        assert(loaded.createEntity() == entities[7]);
+        assert(loaded.createEntity() == 5000);
+
+        Scene mismatched;
+        bool threw = false;
+        try
+        {
+            SceneSnapshot::load<Position>(mismatched, filename);
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+        assert(threw);
+
+        // corrupt counts and entities throw before anything is sized by them, and the scene is left untouched
+        std::vector<char> bytes;
+        {
+            std::ifstream in(filename, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        const std::string corruptFilename = "ecs_test_corrupt_snapshot.bin";
+        auto loadCorrupted = [&](size_t offset, uint32_t value, size_t size)
+        {
+            std::vector<char> corrupt(bytes.begin(), bytes.begin() + size);
+            if (offset + sizeof(value) <= size)
+            {
+                std::memcpy(corrupt.data() + offset, &value, sizeof(value));
+            }
+            std::ofstream(corruptFilename, std::ios::binary).write(corrupt.data(), static_cast<std::streamsize>(corrupt.size()));
+
+            Scene target;
+            target.registerComponents<Position, Health>();
+            bool failed = false;
+            try
+            {
+                SceneSnapshot::load<Position, Health>(target, corruptFilename);
+            }
+            catch (const std::runtime_error&)
+            {
+                failed = true;
+            }
+            assert(failed);
+            assert(target.query<Position>().empty() && target.createEntity() == 0);
+        };
+        const size_t freedCountOffset = offsetof(SceneSnapshot::Header, freedCount);
+        const size_t freedOffset = sizeof(SceneSnapshot::Header);
+        const size_t poolCountOffset = freedOffset + 2 * sizeof(Entity) + offsetof(SceneSnapshot::PoolHeader, count);
+        loadCorrupted(freedCountOffset, UINT32_MAX, bytes.size());
+        loadCorrupted(poolCountOffset, UINT32_MAX / 2, bytes.size());
+        loadCorrupted(freedOffset, 9999, bytes.size());
+        loadCorrupted(0, 0, bytes.size() - 100);
+        std::remove(corruptFilename.c_str());
+        std::remove(filename.c_str());
+    }
+
+    // paged component storage
+    {
+        std::pmr::monotonic_buffer_resource arena;
+        Scene scene(StorageMode::Sparse, &arena);
+        Entity first = scene.createEntity(Particle{1, 2, 3});
+        Particle* address = &scene.getComponent<Particle>(first);
+
+        std::vector<Entity> entities = scene.createEntities(20000, Particle{0, 0, 1});
+        for (int i = 0; i < 20000; i++)
+        {
+            entities.push_back(scene.createEntity(Particle{0, 0, 2}, Position{0, 0}));
+        }
+        assert(&scene.getComponent<Particle>(first) == address);
+        assert(address->z == 3);
+
+        std::vector<Entity> removed(entities.begin() + 100, entities.begin() + 30000);
+        scene.deleteEntities(removed);
+        assert(scene.query<Particle>().size() == 10101);
+        assert(&scene.getComponent<Particle>(first) == address);
+        assert(scene.getComponent<const Particle>(entities.back()).z == 2);
+
+        scene.sort<Particle>([](const Particle& a, const Particle& b) { return a.z > b.z; });
+        assert(scene.getComponent<const Particle>(scene.query<Particle>().front()).z == 3);
+
+        auto group = scene.group<const Particle, const Position>();
+        assert(group.size() == 10000);
+
+        // forEachBlock() walks the pages in dense order, lining up with owners
+        const ComponentPool<Particle>& storage = scene.getComponentStorage<Particle>();
+        size_t blocks = 0, visited = 0;
+        storage.forEachBlock([&](std::span<const Particle> block)
+        {
+            assert(block.data() == &storage.components[visited]);
+            assert(block.front().z == scene.getComponent<const Particle>(storage.owners[visited]).z);
+            blocks++;
+            visited += block.size();
+        });
+        assert(visited == storage.owners.size() && blocks > 1);
+
+        const std::string filename = "ecs_test_paged_snapshot.bin";
+        SceneSnapshot::save<Particle, Position>(scene, filename);
+        Scene loaded;
+        SceneSnapshot::load<Particle, Position>(loaded, filename);
+        assert((loaded.query<Particle, Position>() == scene.query<Particle, Position>()));
+        assert(loaded.getComponent<const Particle>(first).y == 2);
+        std::remove(filename.c_str());
+    }
+
+    // onConstruct(), onUpdate(), onDestroy() and collect()
+    for (StorageMode mode : {StorageMode::Sparse, StorageMode::Archetype})
+    {
+        Scene scene(mode);
+        int constructed = 0, updated = 0, destroyed = 0;
+        scene.onConstruct<Position>([&](Scene& s, Entity e) { assert(s.hasComponent<Position>(e)); constructed++; });
+        scene.onUpdate<Position>([&](Scene&, Entity) { updated++; });
+        Connection destroyConnection = scene.onDestroy<Position>([&](Scene& s, Entity e)
+        {
+            assert(s.hasComponent<Position>(e));
+            destroyed++;
+        });
+        Collector& collector = scene.collect<Position>();
+
+        Entity a = scene.createEntity(Position{0, 0});
+        Entity b = scene.createEntity(Velocity{0, 0});
+        scene.addComponent(b, Position{1, 1});
+        std::vector<Entity> batch = scene.createEntities(3, Position{2, 2}, Health{1});
+        assert(constructed == 5);
+        assert(collector.getChanged().size() == 5);
+
+        collector.clear();
+        scene.patchComponent<Position>(a, [](Position& position) { position.x = 5; });
+        assert(updated == 1 && scene.getComponent<Position>(a).x == 5);
+        assert(collector.getChanged().size() == 1 && collector.getChanged()[0] == a);
+
+        scene.removeComponent<Position>(a);
+        scene.deleteEntity(b);
+        scene.deleteEntities(std::span<const Entity>(batch).first(2));
+        assert(destroyed == 4);
+        assert(collector.getChanged().empty());
+        assert(collector.getDestroyed().size() == 4);
+
+        collector.clear();
+        scene.disconnect(destroyConnection);
+        scene.deleteEntity(batch[2]);
+        assert(destroyed == 4);
+        assert(collector.getDestroyed().size() == 1 && collector.getDestroyed()[0] == batch[2]);
+    }
+
+    // StaticScene
+    {
+        using Static = StaticScene<Position, Velocity, Health>;
+        static_assert(Static::getTypeIndex<Velocity>() == 1);
+        static_assert(Static::getTypeIndex<const Health>() == 2);
+
+        Static scene;
+        Entity a = scene.createEntity(Position{1, 1}, Velocity{1, 0});
+        Entity b = scene.createEntity(Position{2, 2});
+        scene.addComponent(b, Health{3});
+        assert(scene.hasComponent<Velocity>(a) && !scene.hasComponent<Velocity>(b));
+
+        scene.each<Position, const Velocity>([](Position& position, const Velocity& velocity) { position.x += velocity.dx; });
+        assert(scene.getComponent<const Position>(a).x == 2);
+        assert((scene.query<Position, Health>() == std::vector<Entity>{b}));
+
+        scene.removeComponent<Velocity>(a);
+        assert(scene.query<Velocity>().empty());
+        scene.deleteEntity(b);
+        assert(!scene.hasComponent<Health>(b));
+        assert(scene.getPool<Health>().components.empty());
+        assert(scene.createEntity(Health{4}) == b);
+    }
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,109 @@
+#include "silk/TlsfAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <random>
+#include <vector>
+
+using namespace silk;
+
+int main()
+{
+    // TlsfAllocator hands out aligned, disjoint ranges and merges them back on free
+    {
+        TlsfAllocator allocator(1 << 20);
+        assert(allocator.empty() && allocator.getLargestFreeRange() == 1 << 20);
+
+        auto a = allocator.allocate(100);
+        auto b = allocator.allocate(1000, 256);
+        auto c = allocator.allocate(64, 4096);
+        assert(a && b && c);
+        assert(a->offset == 0 && a->size == 100);
+        assert(b->offset % 256 == 0 && b->offset >= a->offset + a->size);
+        assert(c->offset % 4096 == 0 && c->offset >= b->offset + b->size);
+        assert(allocator.getAllocationCount() == 3 && allocator.getUsedSize() == 1164);
+
+        // the padding in front of b and c stays available
+        auto small = allocator.allocate(100);
+        assert(small && small->offset + small->size <= b->offset);
+
+        allocator.free(b->node);
+        allocator.free(a->node);
+        allocator.free(small->node);
+        allocator.free(c->node);
+        assert(allocator.empty() && allocator.getUsedSize() == 0);
+        assert(allocator.getLargestFreeRange() == 1 << 20);
+
+        // the whole range in one piece, then nothing is left
+        auto all = allocator.allocate(1 << 20);
+        assert(all && all->offset == 0);
+        assert(!allocator.allocate(1));
+        allocator.free(all->node);
+        assert(!allocator.allocate((1 << 20) + 1));
+    }
+
+    // TlsfAllocator finds a range that fits exactly even when its bucket is not guaranteed to
+    {
+        TlsfAllocator allocator(1000);
+        auto a = allocator.allocate(300);
+        auto b = allocator.allocate(700);
+        assert(a && b && !allocator.allocate(1));
+        allocator.free(b->node);
+
+        // 700 shares a bucket with larger sizes, so only a search of that bucket finds it
+        auto c = allocator.allocate(700);
+        assert(c && c->offset == 300);
+        allocator.free(c->node);
+        assert(!allocator.allocate(700, 512));
+        auto d = allocator.allocate(400, 512);
+        assert(d && d->offset == 512);
+    }
+
+    // TlsfAllocator stays consistent under random allocations and frees
+    {
+        constexpr uint64_t SIZE = 1 << 24;
+        TlsfAllocator allocator(SIZE);
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<uint64_t> sizes(1, 1 << 16);
+        std::uniform_int_distribution<uint32_t> alignments(0, 12);
+
+        std::vector<TlsfAllocator::Allocation> live;
+        uint64_t used = 0;
+        for (int i = 0; i < 20000; i++)
+        {
+            if (live.empty() || rng() % 3 != 0)
+            {
+                const uint64_t alignment = uint64_t(1) << alignments(rng);
+                if (auto allocation = allocator.allocate(sizes(rng), alignment))
+                {
+                    assert(allocation->offset % alignment == 0 && allocation->offset + allocation->size <= SIZE);
+                    live.push_back(*allocation);
+                    used += allocation->size;
+                }
+            }
+            else
+            {
+                const size_t index = rng() % live.size();
+                allocator.free(live[index].node);
+                used -= live[index].size;
+                live[index] = live.back();
+                live.pop_back();
+            }
+            assert(allocator.getUsedSize() == used && allocator.getAllocationCount() == live.size());
+        }
+
+        std::sort(live.begin(), live.end(), [](const auto& a, const auto& b) { return a.offset < b.offset; });
+        for (size_t i = 1; i < live.size(); i++)
+        {
+            assert(live[i - 1].offset + live[i - 1].size <= live[i].offset);
+        }
+
+        for (const auto& allocation : live)
+        {
+            allocator.free(allocation.node);
+        }
+        assert(allocator.empty() && allocator.getLargestFreeRange() == SIZE);
+    }
+
+    return 0;
+}
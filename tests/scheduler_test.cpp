@@ -0,0 +1,132 @@
+#include "silk/Scheduler.h"
+
+#include <chrono>
+#include <stdexcept>
+
+using namespace silk;
+
+struct Position { float x, y; };
+struct Velocity { float dx, dy; };
+struct Health { int hp; };
+
+int main()
+{
+    // dependencies follow declared access
+    {
+        ThreadPool threadPool(2);
+        Scheduler scheduler(threadPool);
+        scheduler.addSystem<Read<Velocity>, Write<Position>>("movement", [](Scene&) {});
+        scheduler.addSystem<Read<Position>>("render", [](Scene&) {});
+        scheduler.addSystem<Read<Health>>("ui", [](Scene&) {});
+        scheduler.addSystem<Read<>, Write<Velocity>>("input", [](Scene&) {});
+
+        assert(scheduler.getSystemCount() == 4);
+        assert(scheduler.getDependencies("movement").empty());
+        assert(scheduler.getDependencies("render") == std::vector<std::string>{ "movement" });
+        assert(scheduler.getDependencies("ui").empty());
+        assert(scheduler.getDependencies("input") == std::vector<std::string>{ "movement" });
+    }
+
+    // writes are visible to dependent systems
+    {
+        ThreadPool threadPool(4);
+        Scheduler scheduler(threadPool);
+        Scene scene;
+        for (int i = 0; i < 1000; i++)
+        {
+            scene.createEntity(Position{0, 0}, Velocity{1, 2});
+        }
+
+        scheduler.addSystem<Read<Velocity>, Write<Position>>("movement", [](Scene& scene)
+        {
+            scene.each<Position, const Velocity>([](Position& pos, const Velocity& vel)
+            {
+                pos.x += vel.dx;
+                pos.y += vel.dy;
+            });
+        });
+
+        int total = 0;
+        scheduler.addSystem<Read<Position>>("sum", [&total](Scene& scene)
+        {
+            scene.each<const Position>([&total](const Position& pos) { total += static_cast<int>(pos.x + pos.y); });
+        });
+
+        for (int frame = 1; frame <= 3; frame++)
+        {
+            total = 0;
+            scheduler.run(scene);
+            assert(total == 1000 * 3 * frame);
+        }
+    }
+
+    // non-conflicting systems run concurrently
+    {
+        ThreadPool threadPool(2);
+        Scheduler scheduler(threadPool);
+        Scene scene;
+        std::atomic<bool> aStarted = false, bStarted = false;
+        bool aSawB = false, bSawA = false;
+
+        auto waitFor = [](std::atomic<bool>& flag)
+        {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (!flag && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::yield();
+            }
+            return flag.load();
+        };
+
+        scheduler.addSystem<Read<Position>>("a", [&](Scene&) { aStarted = true; aSawB = waitFor(bStarted); });
+        scheduler.addSystem<Read<Position>>("b", [&](Scene&) { bStarted = true; bSawA = waitFor(aStarted); });
+        scheduler.run(scene);
+        assert(aSawB && bSawA);
+    }
+
+    // structural changes are played back after the frame
+    {
+        ThreadPool threadPool(2);
+        Scheduler scheduler(threadPool);
+        Scene scene;
+        Entity e = scene.createEntity(Health{0});
+
+        scheduler.addSystem<Read<Health>>("spawner", [&scheduler](Scene& scene)
+        {
+            scene.each<const Health>([&scheduler](Entity e, const Health&)
+            {
+                SceneCommandBuffer& commandBuffer = scheduler.getCommandBuffer();
+                commandBuffer.addComponent(commandBuffer.createEntity(), Position{1, 1});
+                commandBuffer.removeComponent<Health>(e);
+            });
+        });
+
+        scheduler.run(scene);
+        assert(!scene.hasComponent<Health>(e));
+        assert(scene.query<Position>().size() == 1);
+        assert(scheduler.getCommandBuffer().empty());
+    }
+
+    // exceptions are rethrown on the calling thread
+    {
+        ThreadPool threadPool(2);
+        Scheduler scheduler(threadPool);
+        Scene scene;
+        bool ranAfter = false;
+        scheduler.addSystem<Read<>, Write<Health>>("throws", [](Scene&) { throw std::runtime_error("system failed"); });
+        scheduler.addSystem<Read<Health>>("after", [&ranAfter](Scene&) { ranAfter = true; });
+
+        bool caught = false;
+        try
+        {
+            scheduler.run(scene);
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        assert(caught && ranAfter);
+    }
+
+    return 0;
+}
@@ -0,0 +1,335 @@
+#include "silk/FixedTimestep.h"
+#include "silk/TransformBatch.h"
+#include "silk/TransformHierarchy.h"
+#include "silk/SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+using namespace silk;
+
+static bool nearlyEqual(const glm::mat4& a, const glm::mat4& b)
+{
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            if (std::fabs(a[column][row] - b[column][row]) > 1e-4f)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    // TransformHierarchy composes parent and child matrices
+    {
+        Scene scene;
+        TransformHierarchy hierarchy(scene);
+        Entity root = scene.createEntity(Transform(glm::vec2(10, 0)));
+        Entity child = scene.createEntity(Transform(glm::vec2(0, 5), 1.0f), Parent{root});
+        Entity grandchild = scene.createEntity(Parent{child}, Transform(glm::vec2(1, 1), 0.0f, glm::vec2(2, 2)));
+        Entity orphan = scene.createEntity(Transform(glm::vec2(3, 3)), Parent{12345});
+
+        hierarchy.update();
+        assert(hierarchy.getDepthCount() == 3);
+        assert(hierarchy.getRecomputedCount() == 4);
+        const glm::mat4 rootMatrix = scene.getComponent<const Transform>(root).getMatrix();
+        const glm::mat4 childMatrix = rootMatrix * scene.getComponent<const Transform>(child).getMatrix();
+        assert(nearlyEqual(hierarchy.getWorldMatrix(root), rootMatrix));
+        assert(nearlyEqual(hierarchy.getWorldMatrix(child), childMatrix));
+        assert(nearlyEqual(hierarchy.getWorldMatrix(grandchild), childMatrix * scene.getComponent<const Transform>(grandchild).getMatrix()));
+        assert(nearlyEqual(hierarchy.getWorldMatrix(orphan), scene.getComponent<const Transform>(orphan).getMatrix()));
+        assert(hierarchy.getEntities()[0] == root && hierarchy.getEntities()[3] == grandchild);
+
+        // only the changed subtree is recomputed
+        hierarchy.update();
+        assert(hierarchy.getRecomputedCount() == 0);
+        scene.getComponent<Transform>(child).setPosition(0, 6);
+        hierarchy.update();
+        assert(hierarchy.getRecomputedCount() == 2);
+        assert(hierarchy.getWorldMatrix(grandchild)[3][1] > hierarchy.getWorldMatrix(child)[3][1]);
+
+        // reparenting rebuilds the depth order
+        scene.getComponent<Parent>(grandchild).entity = root;
+        hierarchy.update();
+        assert(hierarchy.getDepthCount() == 2);
+        assert(nearlyEqual(hierarchy.getWorldMatrix(grandchild), rootMatrix * scene.getComponent<const Transform>(grandchild).getMatrix()));
+
+        scene.removeComponent<Parent>(child);
+        hierarchy.update();
+        assert(nearlyEqual(hierarchy.getWorldMatrix(child), scene.getComponent<const Transform>(child).getMatrix()));
+    }
+
+    // a Parent cycle throws instead of hanging, the last world matrices stay until it is broken
+    {
+        Scene scene;
+        TransformHierarchy hierarchy(scene);
+        Entity a = scene.createEntity(Transform(glm::vec2(1, 0)));
+        Entity b = scene.createEntity(Transform(glm::vec2(0, 1)), Parent{a});
+        hierarchy.update();
+        assert(hierarchy.getWorldMatrix(b)[3][0] == 1.0f);
+
+        scene.addComponent(a, Parent{b});
+        bool threw = false;
+        try
+        {
+            hierarchy.update();
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+        assert(threw && hierarchy.getWorldMatrix(b)[3][0] == 1.0f);
+
+        scene.removeComponent<Parent>(a);
+        hierarchy.update();
+        assert(hierarchy.getWorldMatrix(b)[3][0] == 1.0f && hierarchy.getWorldMatrix(b)[3][1] == 1.0f);
+    }
+
+    // wide levels are processed in parallel
+    {
+        ThreadPool threadPool(3);
+        Scene scene;
+        TransformHierarchy hierarchy(scene);
+        Entity root = scene.createEntity(Transform(glm::vec2(100, 0)));
+        std::vector<Entity> children;
+        for (int i = 0; i < 20000; i++)
+        {
+            children.push_back(scene.createEntity(Transform(glm::vec2(static_cast<float>(i), 0)), Parent{root}));
+        }
+
+        hierarchy.update(&threadPool, 1024);
+        assert(hierarchy.getRecomputedCount() == 20001);
+        for (int i = 0; i < 20000; i += 997)
+        {
+            assert(hierarchy.getWorldMatrix(children[i])[3][0] == 100.0f + static_cast<float>(i));
+        }
+
+        scene.getComponent<Transform>(root).setPosition(0, 0);
+        hierarchy.update(&threadPool, 1024);
+        assert(hierarchy.getRecomputedCount() == 20001);
+        assert(hierarchy.getWorldMatrix(children[5])[3][0] == 5.0f);
+    }
+
+    // Transform evaluates its matrix lazily as translate * rotate * scale
+    {
+        Transform transform(glm::vec2(1, 2));
+        transform.setRotation(1.5707964f);
+        transform.setScale(2, 3);
+        const Affine2D& affine = transform.getAffine();
+        const glm::vec2 point = affine.transformPoint(glm::vec2(1, 1));
+        assert(std::fabs(point.x + 2.0f) < 1e-5f && std::fabs(point.y - 4.0f) < 1e-5f);
+        assert(transform.getMatrix()[3][0] == 1.0f && transform.getMatrix()[3][1] == 2.0f && transform.getMatrix()[2][2] == 1.0f);
+
+        transform.setPosition(5, 5);
+        assert(transform.getAffine().translation == glm::vec2(5, 5));
+
+        const Affine2D parent = Transform(glm::vec2(10, 0), 0.5f).getAffine();
+        assert(nearlyEqual((parent * affine).toMat4(), parent.toMat4() * affine.toMat4()));
+    }
+
+    // const reads of a dirty Transform evaluate it on the fly and leave the cache to non-const access
+    {
+        Transform transform(glm::vec2(1, 2), 0.0f, glm::vec2(2, 3));
+        const Transform& reader = transform;
+        assert(reader.getAffine().x == glm::vec2(2, 0) && reader.getMatrix()[3][1] == 2.0f);
+        transform.setPosition(4, 4);
+        assert(reader.getAffine().translation == glm::vec2(4, 4));
+        assert(transform.getAffine().translation == glm::vec2(4, 4) && reader.getMatrix()[3][0] == 4.0f);
+    }
+
+    // computeMatrices matches getMatrix at every supported SIMD level
+    {
+        std::mt19937 rng(5);
+        std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+        std::vector<Transform> transforms;
+        for (int i = 0; i < 1003; i++)
+        {
+            transforms.emplace_back(glm::vec2(value(rng), value(rng)), value(rng), glm::vec2(value(rng), value(rng)));
+        }
+        transforms.emplace_back(glm::vec2(0, 0), 0.0f);
+        transforms.emplace_back(glm::vec2(0, 0), -3.14159265f);
+
+        for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 })
+        {
+            if (level > getSimdLevel())
+            {
+                continue;
+            }
+
+            std::vector<glm::mat4> matrices(transforms.size());
+            computeMatrices(transforms, matrices, level);
+            // written with a stride, as into an instance buffer with per-instance data after the matrix
+            struct Instance { glm::mat4 model; glm::vec4 tint; };
+            std::vector<Instance> instances(transforms.size(), Instance{ glm::mat4(0.0f), glm::vec4(7, 7, 7, 7) });
+            computeMatrices(transforms, reinterpret_cast<std::byte*>(instances.data()), sizeof(Instance), level);
+
+            for (size_t i = 0; i < transforms.size(); i++)
+            {
+                const float scale = std::max(1.0f, std::fabs(transforms[i].getScale().x) + std::fabs(transforms[i].getScale().y));
+                const glm::mat4 expected = transforms[i].getMatrix();
+                for (int column = 0; column < 4; column++)
+                {
+                    for (int row = 0; row < 4; row++)
+                    {
+                        assert(std::fabs(matrices[i][column][row] - expected[column][row]) <= 1e-6f * scale);
+                    }
+                }
+                assert(instances[i].model == matrices[i] && instances[i].tint == glm::vec4(7, 7, 7, 7));
+            }
+        }
+    }
+
+    // computeMatrices over a scene writes in dense order, alongside the entities it returns
+    {
+        Scene scene;
+        std::vector<Entity> entities;
+        for (int i = 0; i < 300; i++)
+        {
+            entities.push_back(scene.createEntity(Transform(glm::vec2(i, -i), 0.01f * i, glm::vec2(1, 2))));
+        }
+        scene.deleteEntity(entities[7]);
+        scene.deleteEntity(entities[100]);
+
+        std::vector<glm::mat4> matrices(scene.getComponentStorage<Transform>().components.size());
+        std::span<const Entity> owners = computeMatrices(scene, reinterpret_cast<std::byte*>(matrices.data()));
+        assert(owners.size() == 298);
+        for (size_t i = 0; i < owners.size(); i++)
+        {
+            assert(nearlyEqual(matrices[i], scene.getComponent<const Transform>(owners[i]).getMatrix()));
+        }
+    }
+
+    // FixedTimestep runs whole ticks and carries the remainder as alpha
+    {
+        FixedTimestep timestep(10.0, 4);
+        assert(timestep.advance(0.25) == 2 && std::fabs(timestep.getAlpha() - 0.5f) < 1e-5f);
+        assert(timestep.advance(0.06) == 1 && std::fabs(timestep.getAlpha() - 0.1f) < 1e-4f);
+        // a stall runs at most maxTicksPerFrame ticks and drops the rest
+        assert(timestep.advance(10.0) == 4 && timestep.getAlpha() < 1.0f);
+        assert(timestep.getTickCount() == 7);
+    }
+
+    // TransformInterpolator blends the state a tick started from with the current one
+    {
+        Scene scene;
+        TransformInterpolator interpolator(scene);
+        Entity a = scene.createEntity(Transform(glm::vec2(0, 0), 3.0f));
+        interpolator.beginTick();
+        scene.getComponent<Transform>(a).setPosition(10, 0);
+        scene.getComponent<Transform>(a).setRotation(-3.0f);
+        Entity b = scene.createEntity(Transform(glm::vec2(5, 5)));
+
+        std::vector<glm::mat4> matrices(2);
+        interpolator.interpolate(0.25f);
+        interpolator.writeMatrices(reinterpret_cast<std::byte*>(matrices.data()));
+        assert(interpolator.getEntities().size() == 2 && interpolator.getEntities()[0] == a);
+        assert(std::fabs(matrices[0][3][0] - 2.5f) < 1e-5f && matrices[1][3][0] == 5.0f);
+        // 3 to -3 turns through pi rather than back through 0
+        assert(std::fabs(matrices[0][0][0] - std::cos(3.0f + (2.0f * 3.14159265f - 6.0f) * 0.25f)) < 1e-5f);
+
+        interpolator.beginTick();
+        interpolator.interpolate(0.5f);
+        interpolator.writeMatrices(reinterpret_cast<std::byte*>(matrices.data()));
+        assert(std::fabs(matrices[0][3][0] - 10.0f) < 1e-5f);
+
+        scene.getComponent<Transform>(a).setPosition(100, 0);
+        interpolator.snap(a);
+        scene.deleteEntity(b);
+        interpolator.interpolate(0.5f);
+        interpolator.writeMatrices(reinterpret_cast<std::byte*>(matrices.data()));
+        assert(interpolator.getEntities().size() == 1 && std::fabs(matrices[0][3][0] - 100.0f) < 1e-5f);
+    }
+
+    // SpatialGrid queries match a full scan
+    {
+        Scene scene;
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> size(0.0f, 6.0f);
+        std::vector<Entity> entities;
+        for (int i = 0; i < 2000; i++)
+        {
+            entities.push_back(scene.createEntity(Transform(glm::vec2(coordinate(rng), coordinate(rng)), 0.0f, glm::vec2(size(rng), size(rng)))));
+        }
+
+        SpatialGrid grid(scene, 8.0f);
+        Entity late = scene.createEntity(Transform(glm::vec2(500, 500)));
+        assert(grid.size() == 2001);
+
+        auto distanceSquared = [&](Entity e, glm::vec2 point)
+        {
+            const Transform& transform = scene.getComponent<const Transform>(e);
+            const glm::vec2 half = glm::abs(transform.getScale()) * 0.5f;
+            const float dx = std::max(std::fabs(point.x - transform.getPosition().x) - half.x, 0.0f);
+            const float dy = std::max(std::fabs(point.y - transform.getPosition().y) - half.y, 0.0f);
+            return dx * dx + dy * dy;
+        };
+
+        auto check = [&]
+        {
+            for (int i = 0; i < 50; i++)
+            {
+                const glm::vec2 point(coordinate(rng), coordinate(rng));
+                const float radius = size(rng) * 3.0f;
+
+                std::vector<Entity> expected;
+                for (Entity e : scene.query<Transform>())
+                {
+                    if (distanceSquared(e, point) <= radius * radius)
+                    {
+                        expected.push_back(e);
+                    }
+                }
+                std::vector<Entity> found = grid.queryRadius(point, radius);
+                std::sort(expected.begin(), expected.end());
+                std::sort(found.begin(), found.end());
+                assert(found == expected);
+
+                const glm::vec2 min = point - glm::vec2(radius, radius);
+                const glm::vec2 max = point + glm::vec2(radius * 2.0f, radius);
+                size_t expectedBoxCount = 0;
+                for (Entity e : scene.query<Transform>())
+                {
+                    const Transform& transform = scene.getComponent<const Transform>(e);
+                    const glm::vec2 half = glm::abs(transform.getScale()) * 0.5f;
+                    const glm::vec2 position = transform.getPosition();
+                    expectedBoxCount += position.x + half.x >= min.x && position.x - half.x <= max.x && position.y + half.y >= min.y && position.y - half.y <= max.y;
+                }
+                assert(grid.queryAABB(min, max).size() == expectedBoxCount);
+
+                float best = INFINITY;
+                for (Entity e : scene.query<Transform>())
+                {
+                    best = std::min(best, distanceSquared(e, point));
+                }
+                const std::optional<Entity> nearest = grid.queryNearest(point);
+                assert(nearest && distanceSquared(*nearest, point) == best);
+            }
+        };
+        check();
+        assert(grid.queryNearest(glm::vec2(480, 480)) == late);
+        assert(!grid.queryNearest(glm::vec2(1000, 1000), 10.0f));
+
+        // movement is picked up by update(), removals immediately
+        for (size_t i = 0; i < entities.size(); i += 3)
+        {
+            scene.getComponent<Transform>(entities[i]).setPosition(coordinate(rng), coordinate(rng));
+        }
+        for (size_t i = 1; i < entities.size(); i += 10)
+        {
+            scene.deleteEntity(entities[i]);
+        }
+        grid.update();
+        assert(grid.size() == 1801);
+        check();
+    }
+
+    return 0;
+}